@@ -19,17 +19,23 @@
 
 #include <clipsmm/clipsmm-config.h>
 #include <clipsmm/activation.h>
+#include <clipsmm/assertpattern.h>
 #include <clipsmm/defaultfacts.h>
 #include <clipsmm/enum.h>
 #include <clipsmm/environment.h>
+#include <clipsmm/environmentgroup.h>
+#include <clipsmm/environmentmanager.h>
+#include <clipsmm/expression.h>
 #include <clipsmm/fact.h>
 #include <clipsmm/factory.h>
 #include <clipsmm/function.h>
 #include <clipsmm/global.h>
 #include <clipsmm/module.h>
+#include <clipsmm/multifieldview.h>
 #include <clipsmm/rule.h>
 #include <clipsmm/pointer.h>
 #include <clipsmm/template.h>
+#include <clipsmm/userfunction.h>
 #include <clipsmm/utility.h>
 #include <clipsmm/value.h>
 
@@ -25,6 +25,14 @@
 
 namespace CLIPS {
 
+  /** An activation as captured by Environment::agenda_snapshot() */
+  struct ActivationInfo {
+    const char* rule; /**< Name of the rule, a CLIPS symbol valid while the rule is defined */
+    const char* module; /**< Module of the agenda, valid while the module is defined */
+    int salience;
+    unsigned long long timetag; /**< Orders activations of the same salience */
+  };
+
   /**
     @author Rick L. Vinyard, Jr. <rvinyard@cs.nmsu.edu>
   */
@@ -0,0 +1,396 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by the clipsmm developers                          *
+ *                                                                         *
+ *   This file is part of the clipsmm library.                             *
+ *                                                                         *
+ *   The clipsmm library is free software; you can redistribute it and/or  *
+ *   modify it under the terms of the GNU General Public License           *
+ *   version 3 as published by the Free Software Foundation.               *
+ *                                                                         *
+ *   The clipsmm library is distributed in the hope that it will be        *
+ *   useful, but WITHOUT ANY WARRANTY; without even the implied warranty   *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU   *
+ *   General Public License for more details.                              *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this software. If not see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+#include "assertpattern.h"
+
+extern "C" {
+  #include <clips/clips.h>
+};
+
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <cstdlib>
+
+#include <clipsmm/environment.h>
+#include <clipsmm/factory.h>
+
+namespace CLIPS {
+
+namespace {
+
+  /** Splits a pattern into parentheses, placeholders and atoms */
+  class PatternLexer {
+    public:
+      enum Kind { OPEN, CLOSE, PLACEHOLDER, ATOM, STRING_ATOM, END, ERROR };
+
+      PatternLexer( const std::string& text ): m_text( text ), m_pos( 0 ) { }
+
+      Kind next( std::string& token ) {
+        token.clear();
+        while ( m_pos < m_text.size() && isspace( (unsigned char)m_text[m_pos] ) )
+          ++m_pos;
+        if ( m_pos == m_text.size() )
+          return END;
+
+        char c = m_text[m_pos];
+        if ( c == '(' ) { ++m_pos; return OPEN; }
+        if ( c == ')' ) { ++m_pos; return CLOSE; }
+
+        if ( c == '"' ) {
+          for ( ++m_pos; m_pos < m_text.size(); ++m_pos ) {
+            c = m_text[m_pos];
+            if ( c == '"' ) {
+              ++m_pos;
+              return STRING_ATOM;
+            }
+            if ( c == '\\' && m_pos + 1 < m_text.size() )
+              c = m_text[++m_pos];
+            token += c;
+          }
+          return ERROR;
+        }
+
+        while ( m_pos < m_text.size() ) {
+          c = m_text[m_pos];
+          if ( isspace( (unsigned char)c ) || c == '(' || c == ')' || c == '"' )
+            break;
+          token += c;
+          ++m_pos;
+        }
+        return ( token == "?" ) ? PLACEHOLDER : ATOM;
+      }
+
+    private:
+      const std::string& m_text;
+      std::string::size_type m_pos;
+  };
+
+  /** True if text has the shape of a CLIPS number, strtod() also accepts inf, nan and hex */
+  bool looks_numeric( const char* text )
+  {
+    if ( strchr( "+-.0123456789", text[0] ) == NULL )
+      return false;
+    return text[ strspn( text, "+-.0123456789eE" ) ] == '\0' && strpbrk( text, "0123456789" ) != NULL;
+  }
+
+}
+
+AssertPattern::AssertPattern( Environment& environment, const std::string& pattern ) :
+    EnvironmentObject( environment, NULL ),
+    m_text( pattern ),
+    m_placeholders( 0 )
+{
+  if ( parse( pattern ) )
+    m_environment.m_assert_patterns.insert( this );
+}
+
+AssertPattern::pointer AssertPattern::create( Environment& environment, const std::string& pattern ) {
+  return AssertPattern::pointer( new AssertPattern( environment, pattern ) );
+}
+
+AssertPattern::~AssertPattern()
+{
+  if ( m_cobj ) {
+    m_environment.m_assert_patterns.erase( this );
+    invalidate();
+  }
+}
+
+bool AssertPattern::parse( const std::string& pattern )
+{
+  void* env = m_environment.cobj();
+  PatternLexer lexer( pattern );
+  std::string token;
+
+  if ( lexer.next( token ) != PatternLexer::OPEN || lexer.next( token ) != PatternLexer::ATOM )
+    return false;
+  m_template_name = token;
+
+  // Unknown templates are ordered, the implied template is only created
+  // once the whole pattern parsed
+  void* tmpl = EnvFindDeftemplate( env, m_template_name.c_str() );
+
+  std::vector<std::string> slot_names;
+  if ( tmpl ) {
+    DATA_OBJECT clipsdo;
+    EnvDeftemplateSlotNames( env, tmpl, &clipsdo );
+    if ( GetpType( &clipsdo ) == MULTIFIELD ) {
+      void* mfp = GetValue( clipsdo );
+      for ( long i = GetDOBegin( clipsdo ); i <= GetDOEnd( clipsdo ); ++i )
+        slot_names.push_back( ValueToString( GetMFValue( mfp, i ) ) );
+    }
+  }
+  // Ordered facts have a single multifield slot named implied
+  bool ordered = ! tmpl || ( slot_names.size() == 1 && slot_names[0] == "implied" );
+
+  std::vector<Slot> slots;
+  while ( true ) {
+    Slot slot;
+    PatternLexer::Kind kind;
+
+    if ( ordered ) {
+      if ( ! slots.empty() )
+        break;
+      slot.multifield = true;
+    } else {
+      kind = lexer.next( token );
+      if ( kind == PatternLexer::CLOSE )
+        break;
+      if ( kind != PatternLexer::OPEN || lexer.next( token ) != PatternLexer::ATOM )
+        return false;
+
+      while ( slot.position < slot_names.size() && slot_names[slot.position] != token )
+        ++slot.position;
+      if ( slot.position == slot_names.size() )
+        return false;
+      for ( unsigned int i = 0; i < slots.size(); ++i )
+        if ( slots[i].position == slot.position )
+          return false;
+      slot.multifield = EnvDeftemplateSlotMultiP( env, tmpl, token.c_str() );
+    }
+
+    while ( ( kind = lexer.next( token ) ) != PatternLexer::CLOSE ) {
+      Item item;
+      const char* text = token.c_str();
+      char* end;
+      switch ( kind ) {
+        case PatternLexer::PLACEHOLDER:
+          item.placeholder = m_placeholders++;
+          break;
+        case PatternLexer::STRING_ATOM:
+          item.atom.type = STRING;
+          item.atom.value = EnvAddSymbol( env, text );
+          break;
+        case PatternLexer::ATOM:
+          if ( looks_numeric( text ) ) {
+            errno = 0;
+            long long integer = strtoll( text, &end, 10 );
+            if ( *end == '\0' && errno == 0 ) {
+              item.atom.type = INTEGER;
+              item.atom.value = EnvAddLong( env, integer );
+              break;
+            }
+            double number = strtod( text, &end );
+            if ( *end == '\0' ) {
+              item.atom.type = FLOAT;
+              item.atom.value = EnvAddDouble( env, number );
+              break;
+            }
+          }
+          if ( token.size() > 2 && token[0] == '[' && token[token.size() - 1] == ']' ) {
+            item.atom.type = INSTANCE_NAME;
+            item.atom.value = EnvAddSymbol( env, token.substr( 1, token.size() - 2 ).c_str() );
+          } else {
+            item.atom.type = SYMBOL;
+            item.atom.value = EnvAddSymbol( env, text );
+          }
+          break;
+        default:
+          return false;
+      }
+      slot.items.push_back( item );
+    }
+
+    if ( ! slot.multifield && slot.items.size() != 1 )
+      return false;
+    slots.push_back( slot );
+  }
+
+  if ( lexer.next( token ) != PatternLexer::END )
+    return false;
+
+  if ( ! tmpl )
+    tmpl = CreateImpliedDeftemplate( env, EnvAddSymbol( env, m_template_name.c_str() ), TRUE );
+  if ( ! tmpl )
+    return false;
+
+  for ( unsigned int s = 0; s < slots.size(); ++s )
+    for ( unsigned int i = 0; i < slots[s].items.size(); ++i )
+      if ( slots[s].items[i].placeholder < 0 )
+        AtomInstall( env, slots[s].items[i].atom.type, slots[s].items[i].atom.value );
+  IncrementDeftemplateBusyCount( env, tmpl );
+
+  m_slots.swap( slots );
+  m_cobj = tmpl;
+  return true;
+}
+
+bool AssertPattern::is_valid() const
+{
+  return m_cobj != NULL;
+}
+
+const std::string& AssertPattern::text() const
+{
+  return m_text;
+}
+
+const std::string& AssertPattern::template_name() const
+{
+  return m_template_name;
+}
+
+unsigned int AssertPattern::placeholders() const
+{
+  return m_placeholders;
+}
+
+AssertPattern::Atom AssertPattern::make_atom( int value ) const
+{
+  return make_atom( static_cast<long long>( value ) );
+}
+
+AssertPattern::Atom AssertPattern::make_atom( long value ) const
+{
+  return make_atom( static_cast<long long>( value ) );
+}
+
+AssertPattern::Atom AssertPattern::make_atom( unsigned int value ) const
+{
+  return make_atom( static_cast<long long>( value ) );
+}
+
+AssertPattern::Atom AssertPattern::make_atom( unsigned long value ) const
+{
+  return make_atom( static_cast<long long>( value ) );
+}
+
+AssertPattern::Atom AssertPattern::make_atom( long long value ) const
+{
+  Atom atom;
+  atom.type = INTEGER;
+  atom.value = EnvAddLong( m_environment.cobj(), value );
+  return atom;
+}
+
+AssertPattern::Atom AssertPattern::make_atom( float value ) const
+{
+  return make_atom( static_cast<double>( value ) );
+}
+
+AssertPattern::Atom AssertPattern::make_atom( double value ) const
+{
+  Atom atom;
+  atom.type = FLOAT;
+  atom.value = EnvAddDouble( m_environment.cobj(), value );
+  return atom;
+}
+
+AssertPattern::Atom AssertPattern::make_atom( const char* value ) const
+{
+  Atom atom;
+  atom.type = STRING;
+  atom.value = EnvAddSymbol( m_environment.cobj(), value );
+  return atom;
+}
+
+AssertPattern::Atom AssertPattern::make_atom( const std::string& value ) const
+{
+  return make_atom( value.c_str() );
+}
+
+AssertPattern::Atom AssertPattern::make_atom( const Value& value ) const
+{
+  Atom atom;
+  switch ( value.type() ) {
+    case TYPE_FLOAT:
+    case TYPE_INTEGER:
+    case TYPE_SYMBOL:
+    case TYPE_STRING:
+    case TYPE_INSTANCE_NAME:
+    case TYPE_EXTERNAL_ADDRESS:
+      break;
+    default:
+      return atom;
+  }
+
+  DATA_OBJECT clipsdo;
+  value_to_data_object_rawenv( m_environment.cobj(), value, &clipsdo );
+  atom.type = GetType( clipsdo );
+  atom.value = GetValue( clipsdo );
+  return atom;
+}
+
+Fact::pointer AssertPattern::assert_values( const Values& values )
+{
+  std::vector<Atom> atoms;
+  atoms.reserve( values.size() );
+  for ( unsigned int i = 0; i < values.size(); ++i )
+    atoms.push_back( make_atom( values[i] ) );
+  return assert_atoms( atoms.empty() ? NULL : &atoms[0], atoms.size() );
+}
+
+Fact::pointer AssertPattern::assert_atoms( const Atom* atoms, std::size_t num_atoms )
+{
+  if ( ! m_cobj || num_atoms != m_placeholders )
+    return Fact::pointer();
+  for ( std::size_t i = 0; i < num_atoms; ++i )
+    if ( atoms[i].value == NULL )
+      return Fact::pointer();
+
+  void* env = m_environment.cobj();
+  struct fact* new_fact = EnvCreateFact( env, m_cobj );
+  if ( new_fact == NULL )
+    return Fact::pointer();
+
+  for ( unsigned int s = 0; s < m_slots.size(); ++s ) {
+    const Slot& slot = m_slots[s];
+    struct field& target = new_fact->theProposition.theFields[slot.position];
+
+    if ( ! slot.multifield ) {
+      const Item& item = slot.items[0];
+      const Atom& atom = ( item.placeholder < 0 ) ? item.atom : atoms[item.placeholder];
+      target.type = atom.type;
+      target.value = atom.value;
+      continue;
+    }
+
+    void* mfp = EnvCreateMultifield( env, slot.items.size() );
+    for ( unsigned int i = 0; i < slot.items.size(); ++i ) {
+      const Item& item = slot.items[i];
+      const Atom& atom = ( item.placeholder < 0 ) ? item.atom : atoms[item.placeholder];
+      SetMFType( mfp, i + 1, atom.type );
+      SetMFValue( mfp, i + 1, atom.value );
+    }
+    target.type = MULTIFIELD;
+    target.value = mfp;
+  }
+
+  EnvAssignFactSlotDefaults( env, new_fact );
+  void* asserted = EnvAssert( env, new_fact );
+  if ( asserted == NULL )
+    return Fact::pointer();
+  return Fact::create( m_environment, asserted );
+}
+
+void AssertPattern::invalidate()
+{
+  if ( ! m_cobj )
+    return;
+
+  void* env = m_environment.cobj();
+  for ( unsigned int s = 0; s < m_slots.size(); ++s )
+    for ( unsigned int i = 0; i < m_slots[s].items.size(); ++i )
+      if ( m_slots[s].items[i].placeholder < 0 )
+        AtomDeinstall( env, m_slots[s].items[i].atom.type, m_slots[s].items[i].atom.value );
+  DecrementDeftemplateBusyCount( env, m_cobj );
+  m_cobj = NULL;
+  m_slots.clear();
+}
+
+}
@@ -0,0 +1,139 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by the clipsmm developers                          *
+ *                                                                         *
+ *   This file is part of the clipsmm library.                             *
+ *                                                                         *
+ *   The clipsmm library is free software; you can redistribute it and/or  *
+ *   modify it under the terms of the GNU General Public License           *
+ *   version 3 as published by the Free Software Foundation.               *
+ *                                                                         *
+ *   The clipsmm library is distributed in the hope that it will be        *
+ *   useful, but WITHOUT ANY WARRANTY; without even the implied warranty   *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU   *
+ *   General Public License for more details.                              *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this software. If not see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+#ifndef CLIPSASSERTPATTERN_H
+#define CLIPSASSERTPATTERN_H
+
+#include <string>
+#include <vector>
+
+#include <clipsmm/value.h>
+#include <clipsmm/fact.h>
+#include <clipsmm/environmentobject.h>
+
+namespace CLIPS {
+
+/**
+ * A fact pattern with placeholders that is parsed once and asserted
+ * repeatedly.
+ *
+ * Patterns are created by Environment::prepare_assert(), e.g.
+ * "(reading (sensor ?) (value ?))" for a deftemplate fact or
+ * "(point ? ? 0)" for an ordered fact. Each ? is a placeholder that is
+ * filled from the arguments of assert_fact() in the order in which the
+ * placeholders appear. The template and the slot positions are
+ * resolved when the pattern is prepared, so asserting a fact only
+ * stores the values into a new fact, without formatting and parsing a
+ * fact string. Slots not mentioned in the pattern get their defaults.
+ *
+ * The template is kept alive while the pattern is valid. The pattern is
+ * invalidated when the environment is cleared.
+ */
+class AssertPattern : public EnvironmentObject
+{
+  public:
+    typedef CLIPSPointer<AssertPattern> pointer;
+
+    AssertPattern( Environment& environment, const std::string& pattern );
+
+    static AssertPattern::pointer create( Environment& environment, const std::string& pattern );
+
+    ~AssertPattern();
+
+    /** True if the pattern was parsed and the environment was not cleared since */
+    bool is_valid() const;
+
+    /** The text the pattern was prepared from */
+    const std::string& text() const;
+
+    /** Name of the template of the asserted facts */
+    const std::string& template_name() const;
+
+    /** Number of placeholders, i.e. the number of arguments assert_fact() takes */
+    unsigned int placeholders() const;
+
+    /**
+     * Asserts a fact with the placeholders filled by the arguments.
+     * Integral arguments become integers, floating point arguments floats
+     * and strings CLIPS strings. Pass a Value to assert a symbol or
+     * instance name. Argument types without a conversion are rejected at
+     * compile time.
+     * @return the asserted fact, or a null pointer if the number of
+     * arguments does not match the placeholders, the pattern is invalid
+     * or the fact could not be asserted
+     */
+    template <typename... T_args>
+    Fact::pointer assert_fact( const T_args&... arguments ) {
+      const Atom atoms[] = { Atom(), make_atom( arguments )... };
+      return assert_atoms( atoms + 1, sizeof...( T_args ) );
+    }
+
+    /** Asserts a fact with the placeholders filled from values */
+    Fact::pointer assert_values( const Values& values );
+
+  protected:
+    friend class Environment;
+
+    /** Releases the template and the constants, called when the environment is cleared */
+    void invalidate();
+
+    /** A CLIPS type and hashed value */
+    struct Atom {
+      Atom(): type( 0 ), value( NULL ) { }
+      unsigned short type;
+      void* value;
+    };
+
+    /** A constant or, if placeholder is not negative, the index of a placeholder */
+    struct Item {
+      Item(): placeholder( -1 ) { }
+      int placeholder;
+      Atom atom;
+    };
+
+    /** The items of a slot, stored at position of the fact */
+    struct Slot {
+      Slot(): position( 0 ), multifield( false ) { }
+      unsigned int position;
+      bool multifield;
+      std::vector<Item> items;
+    };
+
+    std::string m_text;
+    std::string m_template_name;
+    std::vector<Slot> m_slots;
+    unsigned int m_placeholders;
+
+    bool parse( const std::string& pattern );
+
+    Atom make_atom( int value ) const;
+    Atom make_atom( long value ) const;
+    Atom make_atom( long long value ) const;
+    Atom make_atom( unsigned int value ) const;
+    Atom make_atom( unsigned long value ) const;
+    Atom make_atom( float value ) const;
+    Atom make_atom( double value ) const;
+    Atom make_atom( const char* value ) const;
+    Atom make_atom( const std::string& value ) const;
+    Atom make_atom( const Value& value ) const;
+
+    Fact::pointer assert_atoms( const Atom* atoms, std::size_t num_atoms );
+};
+
+}
+
+#endif
@@ -78,10 +78,10 @@ namespace CLIPS {
   }
 
   bool DefaultFacts::retract( ) {
-    if ( m_cobj )
-      return EnvUndeffacts( m_environment.cobj(), m_cobj );
-    else
+    if ( ! m_cobj || ! EnvUndeffacts( m_environment.cobj(), m_cobj ) )
       return false;
+    m_environment.constructs_changed();
+    return true;
   }
 
 }
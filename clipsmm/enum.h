@@ -44,6 +44,15 @@ typedef enum ConflictResolution {
     CONFLICT_DEFAULT_STRATEGY=CONFLICT_DEPTH_STRATEGY,
 } ConflictResolution;
 
+/** Kinds of named constructs, see Environment::get_construct_names() */
+typedef enum ConstructType {
+  CONSTRUCT_RULE,
+  CONSTRUCT_TEMPLATE,
+  CONSTRUCT_FUNCTION,
+  CONSTRUCT_GLOBAL,
+  CONSTRUCT_DEFAULT_FACTS,
+} ConstructType;
+
 }
 
 #endif
@@ -19,6 +19,21 @@
 #include "environment.h"
 
 #include <stdexcept>
+#include <fstream>
+#include <algorithm>
+#include <iterator>
+#include <unordered_map>
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <clipsmm/clipsmm-config.h>
+#ifdef CLIPSMM_HAVE_SYS_EVENTFD_H
+#  include <sys/eventfd.h>
+#endif
 
 extern "C" {
   #include <clips/clips.h>
@@ -28,49 +43,876 @@ extern "C" {
 
 namespace CLIPS {
 
+namespace {
+
+  const unsigned long long FNV_OFFSET_BASIS = 14695981039346656037ULL;
+  const unsigned long long FNV_PRIME = 1099511628211ULL;
+
+  /** FNV-1a, continues hash over the given bytes */
+  unsigned long long fnv1a( unsigned long long hash, const void* data, std::size_t size )
+  {
+    const unsigned char* bytes = static_cast<const unsigned char*>( data );
+    for ( std::size_t i = 0; i < size; ++i ) {
+      hash ^= bytes[i];
+      hash *= FNV_PRIME;
+    }
+    return hash;
+  }
+
+  /** Pending run completions beyond which further ones are merged */
+  const std::size_t MAX_PENDING_COMPLETIONS = 1024;
+
+  /** Start of files written by bsave */
+  const char BINARY_IMAGE_PREFIX[] = "\1\2\3\4CLIPS";
+
+  bool is_binary_image( const char* data, std::size_t size )
+  {
+    return size >= sizeof( BINARY_IMAGE_PREFIX ) - 1 &&
+      memcmp( data, BINARY_IMAGE_PREFIX, sizeof( BINARY_IMAGE_PREFIX ) - 1 ) == 0;
+  }
+
+  /** Creates an unnamed file, CLIPS reads and writes binary images only as files */
+  int open_anonymous_file()
+  {
+#ifdef CLIPSMM_HAVE_MEMFD_CREATE
+    return memfd_create( "clipsmm-image", MFD_CLOEXEC );
+#else
+    char temp_path[] = "/tmp/clipsmm-image-XXXXXX";
+    int fd = mkstemp( temp_path );
+    if ( fd != -1 )
+      unlink( temp_path );
+    return fd;
+#endif
+  }
+
+  std::string descriptor_path( int fd )
+  {
+    char path[64];
+    snprintf( path, sizeof( path ), "/proc/self/fd/%d", fd );
+    return path;
+  }
+
+  /** Copies an atom of another environment into env, NULL for fact and instance addresses */
+  void* copy_atom( void* env, unsigned short type, void* value )
+  {
+    switch ( type ) {
+      case SYMBOL:
+      case STRING:
+      case INSTANCE_NAME:
+        return EnvAddSymbol( env, ValueToString( value ) );
+      case INTEGER:
+        return EnvAddLong( env, ValueToLong( value ) );
+      case FLOAT:
+        return EnvAddDouble( env, ValueToDouble( value ) );
+      case EXTERNAL_ADDRESS:
+        return EnvAddExternalAddress( env, ValueToExternalAddress( value ),
+                                      ( (struct externalAddressHashNode*) value )->type );
+      default:
+        return NULL;
+    }
+  }
+
+  /** Copies the fields begin to end of a multifield of another environment into env */
+  void* copy_multifield( void* env, void* multifield, long int begin, long int end )
+  {
+    void* copy = EnvCreateMultifield( env, end - begin + 1 );
+    for ( long int i = begin, j = 1; i <= end; ++i, ++j ) {
+      unsigned short type = GetMFType( multifield, i );
+      void* value = copy_atom( env, type, GetMFValue( multifield, i ) );
+      if ( value == NULL ) {
+        type = SYMBOL;
+        value = EnvFalseSymbol( env );
+      }
+      SetMFType( copy, j, type );
+      SetMFValue( copy, j, value );
+    }
+    return copy;
+  }
+
+  /**
+   * Splits construct source into its top level forms, with comments
+   * removed and whitespace outside of strings collapsed.
+   * @return false if the last form is not closed
+   */
+  bool split_constructs( const std::string& source, std::vector<std::string>& forms )
+  {
+    std::string form;
+    int depth = 0;
+    bool space = false;
+    for ( std::string::size_type i = 0; i < source.size(); ++i ) {
+      char c = source[i];
+      if ( c == ';' ) {
+        while ( i + 1 < source.size() && source[i + 1] != '\n' )
+          ++i;
+        space = true;
+        continue;
+      }
+      if ( depth == 0 && c != '(' )
+        continue;
+      if ( isspace( static_cast<unsigned char>( c ) ) ) {
+        space = true;
+        continue;
+      }
+      if ( space && ! form.empty() && form[form.size() - 1] != '(' && c != ')' )
+        form += ' ';
+      space = false;
+      form += c;
+      if ( c == '"' ) {
+        for ( ++i; i < source.size() && source[i] != '"'; ++i ) {
+          if ( source[i] == '\\' && i + 1 < source.size() )
+            form += source[i++];
+          form += source[i];
+        }
+        if ( i == source.size() )
+          return false;
+        form += '"';
+      } else if ( c == '(' ) {
+        ++depth;
+      } else if ( c == ')' && --depth == 0 ) {
+        forms.push_back( form );
+        form.clear();
+      }
+    }
+    return depth == 0;
+  }
+
+  /** Top level tokens of a form from split_constructs(), nested forms and strings are single tokens */
+  std::vector<std::string> form_tokens( const std::string& form )
+  {
+    std::vector<std::string> tokens;
+    std::string::size_type i = 1;
+    while ( i + 1 < form.size() ) {
+      if ( form[i] == ' ' ) {
+        ++i;
+        continue;
+      }
+      std::string::size_type start = i;
+      int depth = 0;
+      do {
+        if ( form[i] == '"' ) {
+          for ( ++i; i < form.size() && form[i] != '"'; ++i )
+            if ( form[i] == '\\' )
+              ++i;
+        } else if ( form[i] == '(' ) {
+          ++depth;
+        } else if ( form[i] == ')' && --depth == 0 ) {
+          ++i;
+          break;
+        }
+        ++i;
+      } while ( i + 1 < form.size() &&
+                ( depth > 0 || ( form[i] != ' ' && form[i] != '(' && form[i] != ')' && form[i] != '"' ) ) );
+      tokens.push_back( form.substr( start, i - start ) );
+    }
+    return tokens;
+  }
+
+  /** Qualifies the name of a construct with the module it was defined in */
+  std::string qualified_name( void* env, const std::string& kind, const std::string& name )
+  {
+    const char* module = NULL;
+    void* construct;
+    if ( kind == "defrule" && ( construct = EnvFindDefrule( env, name.c_str() ) ) )
+      module = EnvDefruleModule( env, construct );
+    else if ( kind == "deftemplate" && ( construct = EnvFindDeftemplate( env, name.c_str() ) ) )
+      module = EnvDeftemplateModule( env, construct );
+    else if ( kind == "deffacts" && ( construct = EnvFindDeffacts( env, name.c_str() ) ) )
+      module = EnvDeffactsModule( env, construct );
+    else if ( kind == "deffunction" && ( construct = EnvFindDeffunction( env, name.c_str() ) ) )
+      module = EnvDeffunctionModule( env, construct );
+    else if ( kind == "defglobal" && ( construct = EnvFindDefglobal( env, name.c_str() ) ) )
+      module = EnvDefglobalModule( env, construct );
+    if ( ! module )
+      return name;
+    std::string::size_type separator = name.find( "::" );
+    return std::string( module ) + "::" + ( ( separator == std::string::npos ) ? name : name.substr( separator + 2 ) );
+  }
+
+  const char CHECKPOINT_MAGIC[8] = { 'C', 'L', 'I', 'P', 'S', 'M', 'M', 'C' };
+  const unsigned int CHECKPOINT_VERSION = 1;
+  const unsigned int CHECKPOINT_BYTE_ORDER = 0x01020304;
+
+  /**
+   * Encodes a checkpoint. Lexemes are collected in a table that is written
+   * before the body and are referred to by their position in the table.
+   */
+  class CheckpointWriter {
+    public:
+      CheckpointWriter( void* env ): m_env( env ) { }
+
+      void put_number( unsigned long long n ) {
+        while ( n >= 0x80 ) {
+          m_body += static_cast<char>( ( n & 0x7f ) | 0x80 );
+          n >>= 7;
+        }
+        m_body += static_cast<char>( n );
+      }
+
+      void put_lexeme( void* symbol ) {
+        std::pair<std::unordered_map<void*, unsigned long>::iterator, bool> entry =
+          m_lexemes.insert( std::make_pair( symbol, (unsigned long)m_table.size() ) );
+        if ( entry.second )
+          m_table.push_back( symbol );
+        put_number( entry.first->second );
+      }
+
+      void put_name( const std::string& name ) {
+        put_lexeme( EnvAddSymbol( m_env, name.c_str() ) );
+      }
+
+      void put_atom( unsigned short type, void* value ) {
+        switch ( type ) {
+          case SYMBOL:
+          case STRING:
+          case INSTANCE_NAME:
+            m_body += static_cast<char>( type );
+            put_lexeme( value );
+            break;
+          case INTEGER: {
+            long long n = ValueToLong( value );
+            m_body += static_cast<char>( type );
+            put_number( ( static_cast<unsigned long long>( n ) << 1 ) ^ static_cast<unsigned long long>( n >> 63 ) );
+            break;
+          }
+          case FLOAT: {
+            double d = ValueToDouble( value );
+            m_body += static_cast<char>( type );
+            m_body.append( reinterpret_cast<const char*>( &d ), sizeof( d ) );
+            break;
+          }
+          default:
+            // Addresses do not survive a restart
+            put_atom( SYMBOL, EnvFalseSymbol( m_env ) );
+            break;
+        }
+      }
+
+      void put_field( unsigned short type, void* value, long int begin, long int end ) {
+        if ( type != MULTIFIELD ) {
+          put_atom( type, value );
+          return;
+        }
+        m_body += static_cast<char>( MULTIFIELD );
+        put_number( end - begin + 1 );
+        for ( long int i = begin; i <= end; ++i )
+          put_atom( GetMFType( value, i ), GetMFValue( value, i ) );
+      }
+
+      bool write( const std::string& filename ) {
+        std::string header( CHECKPOINT_MAGIC, sizeof( CHECKPOINT_MAGIC ) );
+        header.append( reinterpret_cast<const char*>( &CHECKPOINT_VERSION ), sizeof( CHECKPOINT_VERSION ) );
+        header.append( reinterpret_cast<const char*>( &CHECKPOINT_BYTE_ORDER ), sizeof( CHECKPOINT_BYTE_ORDER ) );
+        std::string body;
+        body.swap( m_body );
+        put_number( m_table.size() );
+        for ( unsigned long i = 0; i < m_table.size(); ++i ) {
+          const char* lexeme = ValueToString( m_table[i] );
+          std::size_t length = strlen( lexeme );
+          put_number( length );
+          m_body.append( lexeme, length );
+        }
+        header += m_body;
+        m_body.swap( body );
+
+        std::string temp_filename = filename + ".tmp";
+        FILE* file = fopen( temp_filename.c_str(), "wb" );
+        if ( file == NULL )
+          return false;
+        bool ok = fwrite( header.data(), 1, header.size(), file ) == header.size() &&
+                  fwrite( m_body.data(), 1, m_body.size(), file ) == m_body.size();
+        ok = ( fclose( file ) == 0 ) && ok;
+        if ( ok && rename( temp_filename.c_str(), filename.c_str() ) == 0 )
+          return true;
+        unlink( temp_filename.c_str() );
+        return false;
+      }
+
+    private:
+      void* m_env;
+      std::string m_body;
+      std::unordered_map<void*, unsigned long> m_lexemes;
+      std::vector<void*> m_table;
+  };
+
+  /** Decodes a checkpoint, lexemes are added to env as they are read from the table */
+  class CheckpointReader {
+    public:
+      CheckpointReader( void* env, const std::string& data ):
+        m_env( env ), m_pos( data.data() ), m_end( data.data() + data.size() ), m_ok( true ) { }
+
+      bool ok() const { return m_ok; }
+
+      bool read_header() {
+        unsigned int version, byte_order;
+        if ( m_end - m_pos < (long)( sizeof( CHECKPOINT_MAGIC ) + sizeof( version ) + sizeof( byte_order ) ) ||
+             memcmp( m_pos, CHECKPOINT_MAGIC, sizeof( CHECKPOINT_MAGIC ) ) != 0 )
+          return m_ok = false;
+        m_pos += sizeof( CHECKPOINT_MAGIC );
+        memcpy( &version, m_pos, sizeof( version ) );
+        m_pos += sizeof( version );
+        memcpy( &byte_order, m_pos, sizeof( byte_order ) );
+        m_pos += sizeof( byte_order );
+        if ( version != CHECKPOINT_VERSION || byte_order != CHECKPOINT_BYTE_ORDER )
+          return m_ok = false;
+
+        unsigned long long count = get_count();
+        for ( unsigned long long i = 0; m_ok && i < count; ++i ) {
+          unsigned long long length = get_number();
+          if ( length > (unsigned long long)( m_end - m_pos ) )
+            return m_ok = false;
+          m_table.push_back( EnvAddSymbol( m_env, std::string( m_pos, length ).c_str() ) );
+          m_pos += length;
+        }
+        return m_ok;
+      }
+
+      unsigned long long get_number() {
+        unsigned long long n = 0;
+        for ( int shift = 0; m_pos < m_end && shift < 64; shift += 7 ) {
+          unsigned char byte = *m_pos++;
+          n |= static_cast<unsigned long long>( byte & 0x7f ) << shift;
+          if ( ! ( byte & 0x80 ) )
+            return n;
+        }
+        m_ok = false;
+        return 0;
+      }
+
+      /** Reads an element count, every element takes at least one byte of the remaining input */
+      unsigned long long get_count() {
+        unsigned long long n = get_number();
+        if ( n > (unsigned long long)( m_end - m_pos ) ) {
+          m_ok = false;
+          return 0;
+        }
+        return n;
+      }
+
+      void* get_lexeme() {
+        unsigned long long index = get_number();
+        if ( index >= m_table.size() ) {
+          m_ok = false;
+          return EnvFalseSymbol( m_env );
+        }
+        return m_table[index];
+      }
+
+      const char* get_name() {
+        return ValueToString( get_lexeme() );
+      }
+
+      /** Reads a single-field value, returns its type */
+      unsigned short get_atom( void*& value ) {
+        unsigned short type = ( m_pos < m_end ) ? (unsigned char)*m_pos++ : MULTIFIELD;
+        switch ( type ) {
+          case SYMBOL:
+          case STRING:
+          case INSTANCE_NAME:
+            value = get_lexeme();
+            return type;
+          case INTEGER: {
+            unsigned long long n = get_number();
+            value = EnvAddLong( m_env, static_cast<long long>( ( n >> 1 ) ^ ( ~( n & 1 ) + 1 ) ) );
+            return type;
+          }
+          case FLOAT:
+            if ( m_end - m_pos >= (long)sizeof( double ) ) {
+              double d;
+              memcpy( &d, m_pos, sizeof( d ) );
+              m_pos += sizeof( d );
+              value = EnvAddDouble( m_env, d );
+              return type;
+            }
+            // fall through
+          default:
+            m_ok = false;
+            value = EnvFalseSymbol( m_env );
+            return SYMBOL;
+        }
+      }
+
+      /** Reads a value that may be a multifield, returns its type */
+      unsigned short get_field( void*& value ) {
+        if ( m_pos < m_end && (unsigned char)*m_pos == MULTIFIELD ) {
+          ++m_pos;
+          unsigned long long length = get_count();
+          value = EnvCreateMultifield( m_env, length );
+          for ( unsigned long long i = 1; i <= length; ++i ) {
+            void* element;
+            SetMFType( value, i, get_atom( element ) );
+            SetMFValue( value, i, element );
+          }
+          return MULTIFIELD;
+        }
+        return get_atom( value );
+      }
+
+    private:
+      void* m_env;
+      const char* m_pos;
+      const char* m_end;
+      bool m_ok;
+      std::vector<void*> m_table;
+  };
+
+  /** Keeps CLIPS from freeing ephemeral values while it exists */
+  class GarbageCollectionLock {
+    public:
+      GarbageCollectionLock( void* env ): m_env( env ) { EnvIncrementGCLocks( m_env ); }
+      ~GarbageCollectionLock() { EnvDecrementGCLocks( m_env ); }
+
+    private:
+      void* m_env;
+  };
+
+  /** Slot names of a template, "implied" for ordered facts */
+  std::vector<std::string> template_slot_names( void* env, void* tmpl )
+  {
+    std::vector<std::string> names;
+    DATA_OBJECT clipsdo;
+    EnvDeftemplateSlotNames( env, tmpl, &clipsdo );
+    if ( GetType( clipsdo ) == MULTIFIELD ) {
+      void* mfp = GetValue( clipsdo );
+      for ( long int i = GetDOBegin( clipsdo ); i <= GetDOEnd( clipsdo ); ++i )
+        names.push_back( ValueToString( GetMFValue( mfp, i ) ) );
+    }
+    return names;
+  }
+
+  /** Modification time of a file in nanoseconds, whole seconds where stat has no more */
+  long long file_mtime( const struct stat& st )
+  {
+#ifdef CLIPSMM_HAVE_STRUCT_STAT_ST_MTIM
+    return static_cast<long long>( st.st_mtim.tv_sec ) * 1000000000LL + st.st_mtim.tv_nsec;
+#else
+    return static_cast<long long>( st.st_mtime ) * 1000000000LL;
+#endif
+  }
+
+  /**
+   * Modification time to remember for a file that was just read, -1 if it
+   * changed so recently that another change may keep the time, because
+   * file systems record it with a coarse granularity
+   */
+  long long settled_mtime( const struct stat& st )
+  {
+    long long mtime = file_mtime( st );
+    long long now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::system_clock::now().time_since_epoch() ).count();
+    return ( now - mtime < 2000000000LL ) ? -1 : mtime;
+  }
+
+  double seconds_since( std::chrono::steady_clock::time_point start )
+  {
+    return std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+  }
+
+}
+
 std::map<void*, Environment*> Environment::m_environment_map;
 
 Environment::Environment():
-  m_run_thread(NULL)
+  m_function_profiling(false),
+  m_construct_generation(0),
+  m_code_generation(0),
+  m_image_fd(-1),
+  m_image_generation(0),
+  m_construct_names_generation(0),
+  m_handles_generation(0),
+  m_reset_snapshot(false),
+  m_reset_generation(0),
+  m_run_thread(NULL),
+  m_job_active(false),
+  m_active_priority(0),
+  m_preempt_requested(false),
+  m_periodic_callback_installed(false),
+  m_rule_firing_callback_installed(false)
 {
   m_cobj = CreateEnvironment();
 
+  m_notify_fd[0] = m_notify_fd[1] = -1;
+
   m_environment_map[m_cobj] = this;
 
   if ( EnvAddClearFunction( m_cobj, (char *)"clipsmm_clear_callback", Environment::clear_callback, 2001 ) == 0 )
     throw std::logic_error("clipsmm: Error adding clear callback to clips environment");
-  if ( EnvAddPeriodicFunction( m_cobj, (char *)"clipsmm_periodic_callback", Environment::periodic_callback, 2001 ) == 0 )
-    throw std::logic_error("clipsmm: Error adding periodic callback to clips environment");
   if ( EnvAddResetFunction( m_cobj, (char *)"clipsmm_reset_callback", Environment::reset_callback, 2001 ) == 0 )
     throw std::logic_error("clipsmm: Error adding reset callback to clips environment");
-  if ( EnvAddRunFunction( m_cobj, (char *)"clipsmm_rule_firing_callback", Environment::rule_firing_callback, 2001 ) == 0 )
-    throw std::logic_error("clipsmm: Error adding rule firing callback to clips environment");
+  // Halts threaded jobs when a more important one is queued, a no-op otherwise
+  if ( EnvAddRunFunction( m_cobj, (char *)"clipsmm_preempt_callback", Environment::preempt_callback, 2002 ) == 0 )
+    throw std::logic_error("clipsmm: Error adding preemption callback to clips environment");
+  // periodic and rule firing callbacks are installed on demand, see update_callbacks()
 }
 
 Environment::~Environment()
 {
   EnvRemoveClearFunction( m_cobj, (char *)"clipsmm_clear_callback" );
-  EnvRemovePeriodicFunction( m_cobj, (char *)"clipsmm_periodic_callback" );
+  if ( m_periodic_callback_installed )
+    EnvRemovePeriodicFunction( m_cobj, (char *)"clipsmm_periodic_callback" );
   EnvRemoveResetFunction( m_cobj, (char *)"clipsmm_reset_callback" );
-  EnvRemoveRunFunction( m_cobj, (char *)"clipsmm_rule_firing_callback" );
+  EnvRemoveRunFunction( m_cobj, (char *)"clipsmm_preempt_callback" );
+  if ( m_rule_firing_callback_installed )
+    EnvRemoveRunFunction( m_cobj, (char *)"clipsmm_rule_firing_callback" );
+
+  invalidate_prepared();
+  discard_reset_snapshot();
 
   m_environment_map.erase(m_cobj);
 
   DestroyEnvironment( m_cobj );
 
-  std::map<std::string, char *>::iterator r;
-  for (r = m_func_restr.begin(); r != m_func_restr.end(); ++r) {
-    free(r->second);
+  if ( m_image_fd != -1 )
+    close( m_image_fd );
+
+  if ( m_notify_fd[0] != -1 ) {
+    close( m_notify_fd[0] );
+    if ( m_notify_fd[1] != m_notify_fd[0] )
+      close( m_notify_fd[1] );
   }
-  m_func_restr.clear();
 }
 
 bool Environment::batch_evaluate( const std::string& filename ) {
+  ++m_construct_generation;
+  update_callbacks();
   return EnvBatchStar( m_cobj, filename.c_str() );
 }
 
 bool Environment::binary_load( const std::string& filename ) {
-  return EnvBload( m_cobj, filename.c_str() );
+  ++m_construct_generation;
+  invalidate_prepared();
+  discard_reset_snapshot();
+  if ( ! EnvBload( m_cobj, filename.c_str() ) )
+    return false;
+
+  // The constructs cannot be saved again while loaded, clones load the same file
+  if ( m_image_fd != -1 ) {
+    close( m_image_fd );
+    m_image_fd = -1;
+  }
+  m_image_path = filename;
+  m_image_generation = m_construct_generation;
+  m_image_constructs = construct_list();
+  return true;
+}
+
+Environment::pointer Environment::clone( bool copy_working_memory )
+{
+  if ( ! prepare_image() )
+    return Environment::pointer();
+
+  Environment::pointer copy( new Environment() );
+  copy->m_function_profiling = m_function_profiling;
+  std::map<std::string, UserFunction::pointer>::const_iterator f;
+  for ( f = m_slots.begin(); f != m_slots.end(); ++f )
+    copy->define_function( f->first, UserFunction::pointer( f->second->clone() ) );
+
+  // Not through binary_load(), the clone must not refer to this environment's image
+  if ( ! EnvBload( copy->m_cobj, m_image_path.c_str() ) )
+    return Environment::pointer();
+
+  if ( copy_working_memory )
+    this->copy_working_memory( *copy );
+  return copy;
+}
+
+bool Environment::prepare_image()
+{
+  std::vector<void*> constructs = construct_list();
+  if ( ! m_image_path.empty() && m_image_generation == m_construct_generation &&
+       m_image_constructs == constructs )
+    return true;
+
+  m_image_path.clear();
+  if ( m_image_fd == -1 && ( m_image_fd = open_anonymous_file() ) == -1 )
+    return false;
+  std::string path = descriptor_path( m_image_fd );
+  if ( ! EnvBsave( m_cobj, path.c_str() ) )
+    return false;
+
+  m_image_path = path;
+  m_image_generation = m_construct_generation;
+  m_image_constructs.swap( constructs );
+  return true;
+}
+
+std::vector<void*> Environment::construct_list()
+{
+  std::vector<void*> constructs;
+  void* current = EnvGetCurrentModule( m_cobj );
+  for ( void* module = EnvGetNextDefmodule( m_cobj, NULL ); module; module = EnvGetNextDefmodule( m_cobj, module ) ) {
+    constructs.push_back( module );
+    EnvSetCurrentModule( m_cobj, module );
+    void* c;
+    for ( c = EnvGetNextDeftemplate( m_cobj, NULL ); c; c = EnvGetNextDeftemplate( m_cobj, c ) )
+      constructs.push_back( c );
+    for ( c = EnvGetNextDeffacts( m_cobj, NULL ); c; c = EnvGetNextDeffacts( m_cobj, c ) )
+      constructs.push_back( c );
+    for ( c = EnvGetNextDefrule( m_cobj, NULL ); c; c = EnvGetNextDefrule( m_cobj, c ) )
+      constructs.push_back( c );
+    for ( c = EnvGetNextDefglobal( m_cobj, NULL ); c; c = EnvGetNextDefglobal( m_cobj, c ) )
+      constructs.push_back( c );
+    for ( c = EnvGetNextDeffunction( m_cobj, NULL ); c; c = EnvGetNextDeffunction( m_cobj, c ) )
+      constructs.push_back( c );
+  }
+  EnvSetCurrentModule( m_cobj, current );
+  return constructs;
+}
+
+bool Environment::checkpoint( const std::string& filename )
+{
+  CheckpointWriter writer( m_cobj );
+
+  // Templates of the facts with their slot layouts, in order of first use
+  std::map<void*, unsigned long> templates;
+  std::vector<void*> template_order;
+  unsigned long num_facts = 0;
+  for ( void* f = EnvGetNextFact( m_cobj, NULL ); f; f = EnvGetNextFact( m_cobj, f ), ++num_facts ) {
+    void* tmpl = EnvFactDeftemplate( m_cobj, f );
+    if ( templates.insert( std::make_pair( tmpl, (unsigned long)template_order.size() ) ).second )
+      template_order.push_back( tmpl );
+  }
+  writer.put_number( template_order.size() );
+  for ( unsigned int t = 0; t < template_order.size(); ++t ) {
+    writer.put_name( std::string( EnvDeftemplateModule( m_cobj, template_order[t] ) ) + "::" +
+                     EnvGetDeftemplateName( m_cobj, template_order[t] ) );
+    std::vector<std::string> slots = template_slot_names( m_cobj, template_order[t] );
+    writer.put_number( slots.size() );
+    for ( unsigned int i = 0; i < slots.size(); ++i )
+      writer.put_name( slots[i] );
+  }
+
+  std::vector<std::string> globals;
+  void* current = EnvGetCurrentModule( m_cobj );
+  for ( void* module = EnvGetNextDefmodule( m_cobj, NULL ); module; module = EnvGetNextDefmodule( m_cobj, module ) ) {
+    EnvSetCurrentModule( m_cobj, module );
+    for ( void* g = EnvGetNextDefglobal( m_cobj, NULL ); g; g = EnvGetNextDefglobal( m_cobj, g ) )
+      globals.push_back( std::string( EnvGetDefmoduleName( m_cobj, module ) ) + "::" + EnvGetDefglobalName( m_cobj, g ) );
+  }
+  EnvSetCurrentModule( m_cobj, current );
+  writer.put_number( globals.size() );
+  for ( unsigned int i = 0; i < globals.size(); ++i ) {
+    DATA_OBJECT value;
+    EnvGetDefglobalValue( m_cobj, globals[i].c_str(), &value );
+    writer.put_name( globals[i] );
+    writer.put_field( GetType( value ), GetValue( value ), GetDOBegin( value ), GetDOEnd( value ) );
+  }
+
+  writer.put_number( num_facts );
+  for ( void* f = EnvGetNextFact( m_cobj, NULL ); f; f = EnvGetNextFact( m_cobj, f ) ) {
+    struct fact* source = static_cast<struct fact*>( f );
+    writer.put_number( templates[EnvFactDeftemplate( m_cobj, f )] );
+    for ( long int i = 0; i < source->theProposition.multifieldLength; ++i ) {
+      const struct field& slot = source->theProposition.theFields[i];
+      long int length = ( slot.type == MULTIFIELD ) ? GetMFLength( slot.value ) : 0;
+      writer.put_field( slot.type, slot.value, 1, length );
+    }
+  }
+
+  // Top of the stack first
+  DATA_OBJECT focus;
+  EnvGetFocusStack( m_cobj, &focus );
+  long int focus_length = ( GetType( focus ) == MULTIFIELD ) ? GetDOLength( focus ) : 0;
+  writer.put_number( focus_length );
+  for ( long int i = 0; i < focus_length; ++i )
+    writer.put_lexeme( GetMFValue( GetValue( focus ), GetDOBegin( focus ) + i ) );
+
+  return writer.write( filename );
+}
+
+bool Environment::restore( const std::string& filename )
+{
+  std::ifstream file( filename.c_str(), std::ios::in | std::ios::binary );
+  if ( ! file )
+    return false;
+  std::string data( ( std::istreambuf_iterator<char>( file ) ), std::istreambuf_iterator<char>() );
+
+  // Decoded values are ephemeral until their fact is asserted, asserting
+  // may run the periodic cleanup that would free those of later facts
+  GarbageCollectionLock gc_lock( m_cobj );
+  CheckpointReader reader( m_cobj, data );
+  if ( ! reader.read_header() )
+    return false;
+
+  // The whole checkpoint is decoded before anything is changed, a damaged
+  // one leaves the environment untouched
+  struct Layout {
+    std::string name;
+    std::vector<std::string> slots;
+    bool ordered;
+    void* tmpl;
+    std::vector<long int> positions; // Position in the target template, -1 if gone
+    std::vector<bool> multifield;
+  };
+  struct DecodedFact {
+    unsigned long long layout;
+    std::vector<unsigned short> types;
+    std::vector<void*> values;
+  };
+
+  std::vector<Layout> layouts;
+  unsigned long long num_layouts = reader.get_count();
+  for ( unsigned long long t = 0; reader.ok() && t < num_layouts; ++t ) {
+    Layout layout;
+    layout.name = reader.get_name();
+    unsigned long long num_slots = reader.get_count();
+    for ( unsigned long long i = 0; reader.ok() && i < num_slots; ++i )
+      layout.slots.push_back( reader.get_name() );
+    // Ordered facts have a single multifield slot named implied
+    layout.ordered = ( layout.slots.size() == 1 && layout.slots[0] == "implied" );
+    layout.tmpl = NULL;
+    layouts.push_back( layout );
+  }
+
+  std::vector<std::pair<std::string, DATA_OBJECT> > globals;
+  unsigned long long num_globals = reader.get_count();
+  for ( unsigned long long i = 0; reader.ok() && i < num_globals; ++i ) {
+    std::string name = reader.get_name();
+    DATA_OBJECT value;
+    void* v;
+    unsigned short type = reader.get_field( v );
+    SetType( value, type );
+    SetValue( value, v );
+    if ( type == MULTIFIELD ) {
+      SetDOBegin( value, 1 );
+      SetDOEnd( value, GetMFLength( v ) );
+    }
+    globals.push_back( std::make_pair( name, value ) );
+  }
+
+  std::vector<DecodedFact> facts;
+  unsigned long long num_facts = reader.get_count();
+  for ( unsigned long long n = 0; reader.ok() && n < num_facts; ++n ) {
+    DecodedFact decoded;
+    decoded.layout = reader.get_number();
+    if ( decoded.layout >= layouts.size() )
+      return false;
+    for ( unsigned int i = 0; reader.ok() && i < layouts[decoded.layout].slots.size(); ++i ) {
+      void* value;
+      decoded.types.push_back( reader.get_field( value ) );
+      decoded.values.push_back( value );
+    }
+    facts.push_back( decoded );
+  }
+
+  std::vector<std::string> focus;
+  unsigned long long focus_length = reader.get_count();
+  for ( unsigned long long i = 0; reader.ok() && i < focus_length; ++i )
+    focus.push_back( reader.get_name() );
+  if ( ! reader.ok() )
+    return false;
+
+  // Facts of unknown templates are only restored if they were ordered
+  for ( unsigned int t = 0; t < layouts.size(); ++t ) {
+    Layout& layout = layouts[t];
+    layout.tmpl = EnvFindDeftemplate( m_cobj, layout.name.c_str() );
+    if ( ! layout.tmpl && layout.ordered ) {
+      const char* separator = strstr( layout.name.c_str(), "::" );
+      layout.tmpl = CreateImpliedDeftemplate( m_cobj, EnvAddSymbol( m_cobj, separator ? separator + 2 : layout.name.c_str() ), TRUE );
+    }
+    std::vector<std::string> target_slots;
+    if ( layout.tmpl )
+      target_slots = template_slot_names( m_cobj, layout.tmpl );
+    for ( unsigned int i = 0; i < layout.slots.size(); ++i ) {
+      const std::string& slot = layout.slots[i];
+      long int position = std::find( target_slots.begin(), target_slots.end(), slot ) - target_slots.begin();
+      if ( position == (long int)target_slots.size() )
+        position = -1;
+      layout.positions.push_back( position );
+      layout.multifield.push_back( position >= 0 &&
+        ( slot == "implied" || EnvDeftemplateSlotMultiP( m_cobj, layout.tmpl, slot.c_str() ) ) );
+    }
+  }
+
+  for ( unsigned int i = 0; i < globals.size(); ++i )
+    if ( EnvFindDefglobal( m_cobj, globals[i].first.c_str() ) )
+      EnvSetDefglobalValue( m_cobj, globals[i].first.c_str(), &globals[i].second );
+
+  for ( std::vector<DecodedFact>::iterator f = facts.begin(); f != facts.end(); ++f ) {
+    const Layout& layout = layouts[f->layout];
+    if ( ! layout.tmpl )
+      continue;
+    struct fact* restored = EnvCreateFact( m_cobj, layout.tmpl );
+    for ( unsigned int i = 0; i < layout.positions.size(); ++i ) {
+      // Values of removed slots, or that changed between single and multifield, are dropped
+      if ( layout.positions[i] >= 0 && ( f->types[i] == MULTIFIELD ) == layout.multifield[i] ) {
+        restored->theProposition.theFields[layout.positions[i]].type = f->types[i];
+        restored->theProposition.theFields[layout.positions[i]].value = f->values[i];
+      }
+    }
+    EnvAssignFactSlotDefaults( m_cobj, restored );
+    EnvAssert( m_cobj, restored );
+  }
+
+  if ( ! focus.empty() ) {
+    EnvClearFocusStack( m_cobj );
+    for ( std::vector<std::string>::reverse_iterator m = focus.rbegin(); m != focus.rend(); ++m ) {
+      void* module = EnvFindDefmodule( m_cobj, m->c_str() );
+      if ( module )
+        EnvFocus( m_cobj, module );
+    }
+  }
+  return true;
+}
+
+void Environment::copy_working_memory( Environment& target )
+{
+  void* env = target.m_cobj;
+  void* current = EnvGetCurrentModule( m_cobj );
+  for ( void* module = EnvGetNextDefmodule( m_cobj, NULL ); module; module = EnvGetNextDefmodule( m_cobj, module ) ) {
+    EnvSetCurrentModule( m_cobj, module );
+    std::string prefix = std::string( EnvGetDefmoduleName( m_cobj, module ) ) + "::";
+    for ( void* g = EnvGetNextDefglobal( m_cobj, NULL ); g; g = EnvGetNextDefglobal( m_cobj, g ) ) {
+      std::string name = prefix + EnvGetDefglobalName( m_cobj, g );
+      DATA_OBJECT value, copy;
+      EnvGetDefglobalValue( m_cobj, name.c_str(), &value );
+      if ( GetType( value ) == MULTIFIELD ) {
+        SetType( copy, MULTIFIELD );
+        SetValue( copy, copy_multifield( env, GetValue( value ), GetDOBegin( value ), GetDOEnd( value ) ) );
+        SetDOBegin( copy, 1 );
+        SetDOEnd( copy, GetDOLength( value ) );
+      } else {
+        void* atom = copy_atom( env, GetType( value ), GetValue( value ) );
+        SetType( copy, atom ? GetType( value ) : SYMBOL );
+        SetValue( copy, atom ? atom : EnvFalseSymbol( env ) );
+      }
+      EnvSetDefglobalValue( env, name.c_str(), &copy );
+    }
+  }
+  EnvSetCurrentModule( m_cobj, current );
+
+  // Templates are looked up once per template, not once per fact
+  std::map<void*, void*> templates;
+  for ( void* f = EnvGetNextFact( m_cobj, NULL ); f; f = EnvGetNextFact( m_cobj, f ) ) {
+    struct fact* source = static_cast<struct fact*>( f );
+    void* source_template = EnvFactDeftemplate( m_cobj, f );
+    std::map<void*, void*>::iterator t = templates.find( source_template );
+    if ( t == templates.end() ) {
+      std::string name = std::string( EnvDeftemplateModule( m_cobj, source_template ) ) + "::" +
+                         EnvGetDeftemplateName( m_cobj, source_template );
+      void* target_template = EnvFindDeftemplate( env, name.c_str() );
+      if ( ! target_template )
+        target_template = CreateImpliedDeftemplate( env, EnvAddSymbol( env, EnvGetDeftemplateName( m_cobj, source_template ) ), TRUE );
+      t = templates.insert( std::make_pair( source_template, target_template ) ).first;
+    }
+    if ( ! t->second )
+      continue;
+
+    struct fact* copy = EnvCreateFact( env, t->second );
+    for ( long int i = 0; i < source->theProposition.multifieldLength; ++i ) {
+      const struct field& from = source->theProposition.theFields[i];
+      struct field& to = copy->theProposition.theFields[i];
+      if ( from.type == MULTIFIELD ) {
+        to.type = MULTIFIELD;
+        to.value = copy_multifield( env, from.value, 1, GetMFLength( from.value ) );
+      } else if ( ( to.value = copy_atom( env, from.type, from.value ) ) != NULL ) {
+        to.type = from.type;
+      } else {
+        to.type = SYMBOL;
+        to.value = EnvFalseSymbol( env );
+      }
+    }
+    EnvAssert( env, copy );
+  }
 }
 
 bool Environment::binary_save( const std::string& filename ) {
@@ -78,6 +920,7 @@ bool Environment::binary_save( const std::string& filename ) {
 }
 
 bool Environment::build( const std::string& construct ) {
+  ++m_construct_generation;
   return EnvBuild( m_cobj, construct.c_str() );
 }
 
@@ -87,14 +930,420 @@ void Environment::clear( ) {
 
 int Environment::load( const std::string& filename )
 {
+  ++m_construct_generation;
+  update_callbacks();
   return EnvLoad( m_cobj, filename.c_str() );
 }
 
+Environment::LoadCacheStats::LoadCacheStats():
+  hits(0), misses(0), hash_time(0), load_time(0), save_time(0)
+{ }
+
+int Environment::load_cached( const std::vector<std::string>& filenames, const std::string& cache_dir )
+{
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  // Images depend on the build, not only on the sources
+  unsigned long long hash = FNV_OFFSET_BASIS;
+  hash = fnv1a( hash, CLIPSMM_PACKAGE_VERSION, strlen( CLIPSMM_PACKAGE_VERSION ) );
+  unsigned int pointer_size = sizeof( void* );
+  hash = fnv1a( hash, &pointer_size, sizeof( pointer_size ) );
+
+  char buffer[65536];
+  for ( unsigned int i = 0; i < filenames.size(); ++i ) {
+    std::ifstream file( filenames[i].c_str(), std::ios::in | std::ios::binary );
+    if ( ! file )
+      return 0;
+    unsigned long long size = 0;
+    while ( file.read( buffer, sizeof( buffer ) ) || file.gcount() > 0 ) {
+      hash = fnv1a( hash, buffer, file.gcount() );
+      size += file.gcount();
+    }
+    // Separates the files, moving text between them changes the hash
+    hash = fnv1a( hash, &size, sizeof( size ) );
+  }
+
+  char hex[17];
+  snprintf( hex, sizeof( hex ), "%016llx", hash );
+  std::string image = cache_dir + "/" + hex + ".bin";
+  m_load_cache_stats.hash_time += seconds_since( start );
+
+  start = std::chrono::steady_clock::now();
+  if ( std::ifstream( image.c_str() ).good() && binary_load( image ) ) {
+    m_load_cache_stats.hits += 1;
+    m_load_cache_stats.load_time += seconds_since( start );
+    return 1;
+  }
+
+  // No image or an unusable one, rebuild it from the sources
+  m_load_cache_stats.misses += 1;
+  clear();
+  int rv = 1;
+  for ( unsigned int i = 0; i < filenames.size(); ++i ) {
+    int file_rv = load( filenames[i] );
+    // 0 (file not found) is worse than -1 (errors while loading)
+    if ( file_rv == 0 || ( file_rv < rv && rv != 0 ) )
+      rv = file_rv;
+  }
+  m_load_cache_stats.load_time += seconds_since( start );
+
+  if ( rv == 1 ) {
+    start = std::chrono::steady_clock::now();
+    char suffix[64];
+    snprintf( suffix, sizeof( suffix ), ".tmp.%ld.%p", (long int)getpid(), (void*)this );
+    std::string temp_image = image + suffix;
+    if ( ! binary_save( temp_image ) || rename( temp_image.c_str(), image.c_str() ) != 0 )
+      unlink( temp_image.c_str() );
+    m_load_cache_stats.save_time += seconds_since( start );
+  }
+  return rv;
+}
+
+int Environment::load_from_memory( const char* data, std::size_t size )
+{
+  if ( is_binary_image( data, size ) )
+    return binary_load_from_memory( data, size ) ? 1 : 0;
+
+  ++m_construct_generation;
+  update_callbacks();
+  return EnvLoadFromString( m_cobj, data, size ) ? 1 : -1;
+}
+
+bool Environment::binary_load_from_memory( const char* data, std::size_t size )
+{
+  int fd = open_anonymous_file();
+  if ( fd == -1 )
+    return false;
+
+  for ( std::size_t written = 0; written < size; ) {
+    ssize_t n = write( fd, data + written, size - written );
+    if ( n <= 0 ) {
+      close( fd );
+      return false;
+    }
+    written += n;
+  }
+
+  if ( ! binary_load( descriptor_path( fd ) ) ) {
+    close( fd );
+    return false;
+  }
+  // Keep the file, clones load the same image
+  m_image_fd = fd;
+  return true;
+}
+
+int Environment::load_mapped( const std::string& filename )
+{
+  int fd = open( filename.c_str(), O_RDONLY | O_CLOEXEC );
+  if ( fd == -1 )
+    return 0;
+
+  struct stat st;
+  char prefix[sizeof( BINARY_IMAGE_PREFIX ) - 1];
+  ssize_t prefix_size = pread( fd, prefix, sizeof( prefix ), 0 );
+  if ( fstat( fd, &st ) != 0 || prefix_size < 0 ) {
+    close( fd );
+    return 0;
+  }
+
+  if ( is_binary_image( prefix, prefix_size ) ) {
+    close( fd );
+    return binary_load( filename ) ? 1 : -1;
+  }
+
+  std::size_t size = st.st_size;
+  if ( size == 0 ) {
+    close( fd );
+    return load_from_memory( "", 0 );
+  }
+
+  void* data = mmap( NULL, size, PROT_READ, MAP_PRIVATE, fd, 0 );
+  close( fd );
+  if ( data == MAP_FAILED )
+    return 0;
+  madvise( data, size, MADV_SEQUENTIAL );
+
+  ++m_construct_generation;
+  update_callbacks();
+  int rv = EnvLoadFromString( m_cobj, static_cast<const char*>( data ), size ) ? 1 : -1;
+  munmap( data, size );
+  return rv;
+}
+
+Environment::LoadCacheStats Environment::load_cache_stats() const
+{
+  return m_load_cache_stats;
+}
+
+void Environment::reset_load_cache_stats()
+{
+  m_load_cache_stats = LoadCacheStats();
+}
+
+int Environment::load_tracked( const std::string& filename )
+{
+  struct stat st;
+  std::ifstream file( filename.c_str(), std::ios::in | std::ios::binary );
+  if ( ! file || stat( filename.c_str(), &st ) != 0 )
+    return 0;
+  std::string source( ( std::istreambuf_iterator<char>( file ) ), std::istreambuf_iterator<char>() );
+
+  if ( m_tracked_files.find( filename ) == m_tracked_files.end() )
+    m_tracked_order.push_back( filename );
+  TrackedFile& tracked = m_tracked_files[filename];
+  tracked.mtime = settled_mtime( st );
+  tracked.size = st.st_size;
+  tracked.hash = fnv1a( FNV_OFFSET_BASIS, source.data(), source.size() );
+
+  std::vector<std::string> constructs;
+  bool ok = split_constructs( source, constructs );
+  ok = build_tracked( tracked, constructs, std::set<std::string>() ) && ok;
+  return ok ? 1 : -1;
+}
+
+int Environment::reload_changed()
+{
+  bool ok = true;
+  std::map<std::string, std::vector<std::string> > reload;
+  for ( std::vector<std::string>::iterator f = m_tracked_order.begin(); f != m_tracked_order.end(); ++f ) {
+    TrackedFile& tracked = m_tracked_files[*f];
+    struct stat st;
+    if ( stat( f->c_str(), &st ) != 0 ) {
+      ok = false;
+      continue;
+    }
+    // Files read right after a change are hashed again, see settled_mtime()
+    if ( file_mtime( st ) == tracked.mtime && st.st_size == tracked.size )
+      continue;
+    std::ifstream file( f->c_str(), std::ios::in | std::ios::binary );
+    std::string source( ( std::istreambuf_iterator<char>( file ) ), std::istreambuf_iterator<char>() );
+    if ( ! file ) {
+      ok = false;
+      continue;
+    }
+    tracked.mtime = settled_mtime( st );
+    tracked.size = st.st_size;
+    unsigned long long hash = fnv1a( FNV_OFFSET_BASIS, source.data(), source.size() );
+    if ( hash == tracked.hash )
+      continue;
+    tracked.hash = hash;
+    ok = split_constructs( source, reload[*f] ) && ok;
+  }
+  if ( reload.empty() )
+    return ok ? 0 : -1;
+
+  // Templates defined the same way again keep their facts
+  std::set<std::string> kept;
+  std::map<std::string, std::vector<std::string> >::iterator r;
+  for ( r = reload.begin(); r != reload.end(); ++r )
+    for ( std::vector<std::string>::iterator c = r->second.begin(); c != r->second.end(); ++c )
+      if ( c->compare( 0, 13, "(deftemplate " ) == 0 )
+        kept.insert( *c );
+
+  if ( ! undefine_tracked( reload, kept ) && reload.size() < m_tracked_order.size() ) {
+    // Constructs of unchanged files still use what should be undefined
+    for ( std::vector<std::string>::iterator f = m_tracked_order.begin(); f != m_tracked_order.end(); ++f ) {
+      if ( reload.find( *f ) != reload.end() )
+        continue;
+      std::vector<std::string>& constructs = reload[*f];
+      const std::vector<TrackedConstruct>& tracked = m_tracked_files[*f].constructs;
+      for ( std::vector<TrackedConstruct>::const_iterator c = tracked.begin(); c != tracked.end(); ++c ) {
+        constructs.push_back( c->text );
+        if ( c->kind == "deftemplate" )
+          kept.insert( c->text );
+      }
+    }
+    ok = undefine_tracked( reload, kept ) && ok;
+  }
+
+  for ( std::vector<std::string>::iterator f = m_tracked_order.begin(); f != m_tracked_order.end(); ++f )
+    if ( ( r = reload.find( *f ) ) != reload.end() )
+      ok = build_tracked( m_tracked_files[*f], r->second, kept ) && ok;
+  return ok ? static_cast<int>( reload.size() ) : -1;
+}
+
+std::vector<std::string> Environment::tracked_files()
+{
+  return m_tracked_order;
+}
+
+bool Environment::build_tracked( TrackedFile& file, const std::vector<std::string>& constructs,
+                                 const std::set<std::string>& kept )
+{
+  ++m_construct_generation;
+  update_callbacks();
+
+  bool ok = true;
+  void* current = EnvGetCurrentModule( m_cobj );
+  EnvSetCurrentModule( m_cobj, EnvFindDefmodule( m_cobj, "MAIN" ) );
+  file.constructs.clear();
+  for ( std::vector<std::string>::const_iterator c = constructs.begin(); c != constructs.end(); ++c ) {
+    std::vector<std::string> tokens = form_tokens( *c );
+    TrackedConstruct construct;
+    construct.kind = tokens.empty() ? "" : tokens[0];
+    construct.text = *c;
+
+    // Modules cannot be undefined, and kept templates were not
+    void* module = ( construct.kind == "defmodule" && tokens.size() > 1 ) ? EnvFindDefmodule( m_cobj, tokens[1].c_str() ) : NULL;
+    bool defined = kept.count( *c ) && tokens.size() > 1 && EnvFindDeftemplate( m_cobj, tokens[1].c_str() );
+    if ( module )
+      EnvSetCurrentModule( m_cobj, module );
+    else if ( ! defined && ! EnvBuild( m_cobj, c->c_str() ) ) {
+      ok = false;
+      continue;
+    }
+
+    if ( construct.kind == "defglobal" ) {
+      std::string prefix = ( tokens.size() > 1 && tokens[1].compare( 0, 2, "?*" ) != 0 ) ? tokens[1] + "::" : "";
+      for ( unsigned int i = 1; i + 1 < tokens.size(); ++i )
+        if ( tokens[i].size() > 3 && tokens[i].compare( 0, 2, "?*" ) == 0 && tokens[i + 1] == "=" )
+          construct.names.push_back( qualified_name( m_cobj, construct.kind, prefix + tokens[i].substr( 2, tokens[i].size() - 3 ) ) );
+    } else if ( tokens.size() > 1 ) {
+      construct.names.push_back( qualified_name( m_cobj, construct.kind, tokens[1] ) );
+    }
+    file.constructs.push_back( construct );
+  }
+  EnvSetCurrentModule( m_cobj, current );
+  return ok;
+}
+
+bool Environment::undefine_tracked( const std::map<std::string, std::vector<std::string> >& files,
+                                    const std::set<std::string>& kept )
+{
+  ++m_construct_generation;
+
+  // Rules use everything else, templates are used by everything else
+  static const char* order[] = { "defrule", "deffacts", "deffunction", "defglobal", "deftemplate" };
+  bool ok = true;
+  for ( unsigned int k = 0; k < sizeof( order ) / sizeof( order[0] ); ++k ) {
+    std::map<std::string, std::vector<std::string> >::const_iterator f;
+    for ( f = files.begin(); f != files.end(); ++f ) {
+      const std::vector<TrackedConstruct>& constructs = m_tracked_files[f->first].constructs;
+      for ( std::vector<TrackedConstruct>::const_iterator c = constructs.begin(); c != constructs.end(); ++c ) {
+        if ( c->kind != order[k] || kept.count( c->text ) )
+          continue;
+        for ( std::vector<std::string>::const_iterator n = c->names.begin(); n != c->names.end(); ++n ) {
+          if ( c->kind == "defrule" ) {
+            Rule::pointer rule = get_rule( *n );
+            ok = ( ! rule || rule->retract() ) && ok;
+          } else if ( c->kind == "deffacts" ) {
+            void* deffacts = EnvFindDeffacts( m_cobj, n->c_str() );
+            ok = ( ! deffacts || DefaultFacts::create( *this, deffacts )->retract() ) && ok;
+          } else if ( c->kind == "deffunction" ) {
+            Function::pointer function = get_function( *n );
+            ok = ( ! function || function->undefine() ) && ok;
+          } else if ( c->kind == "defglobal" ) {
+            Global::pointer global = get_global( *n );
+            ok = ( ! global || global->undefine() ) && ok;
+          } else {
+            Template::pointer tmpl = get_template( *n );
+            if ( ! tmpl )
+              continue;
+            // The facts go with the old definition
+            std::vector<void*> facts;
+            for ( void* fact = EnvGetNextFactInTemplate( m_cobj, tmpl->cobj(), NULL ); fact;
+                  fact = EnvGetNextFactInTemplate( m_cobj, tmpl->cobj(), fact ) )
+              facts.push_back( fact );
+            for ( std::vector<void*>::iterator fact = facts.begin(); fact != facts.end(); ++fact )
+              EnvRetract( m_cobj, *fact );
+            ok = tmpl->retract() && ok;
+          }
+        }
+      }
+    }
+  }
+  return ok;
+}
+
 void Environment::reset( )
 {
+  update_callbacks();
   EnvReset( m_cobj );
 }
 
+void Environment::fast_reset( )
+{
+  std::vector<void*> constructs = construct_list();
+  if ( ! m_reset_snapshot || m_reset_generation != m_construct_generation ||
+       m_reset_constructs != constructs || EnvGetNextInstance( m_cobj, NULL ) ) {
+    discard_reset_snapshot();
+    reset();
+    if ( EnvGetNextInstance( m_cobj, NULL ) )
+      return;
+
+    for ( void* f = EnvGetNextFact( m_cobj, NULL ); f; f = EnvGetNextFact( m_cobj, f ) ) {
+      EnvIncrementFactCount( m_cobj, f );
+      m_reset_facts.push_back( f );
+    }
+    void* current = EnvGetCurrentModule( m_cobj );
+    for ( void* module = EnvGetNextDefmodule( m_cobj, NULL ); module; module = EnvGetNextDefmodule( m_cobj, module ) ) {
+      EnvSetCurrentModule( m_cobj, module );
+      for ( void* g = EnvGetNextDefglobal( m_cobj, NULL ); g; g = EnvGetNextDefglobal( m_cobj, g ) )
+        m_reset_globals.push_back( g );
+      for ( void* r = EnvGetNextDefrule( m_cobj, NULL ); r; r = EnvGetNextDefrule( m_cobj, r ) )
+        m_reset_rules.push_back( r );
+    }
+    EnvSetCurrentModule( m_cobj, current );
+    m_reset_constructs.swap( constructs );
+    m_reset_generation = m_construct_generation;
+    m_reset_snapshot = true;
+    return;
+  }
+
+  update_callbacks();
+
+  // Retract what was asserted since, before reasserting, so no duplicates are rejected
+  std::set<void*> snapshot( m_reset_facts.begin(), m_reset_facts.end() );
+  std::vector<void*> added;
+  for ( void* f = EnvGetNextFact( m_cobj, NULL ); f; f = EnvGetNextFact( m_cobj, f ) )
+    if ( snapshot.find( f ) == snapshot.end() )
+      added.push_back( f );
+  for ( std::vector<void*>::iterator f = added.begin(); f != added.end(); ++f )
+    EnvRetract( m_cobj, *f );
+
+  EnvClearFocusStack( m_cobj );
+  EnvFocus( m_cobj, EnvFindDefmodule( m_cobj, "MAIN" ) );
+  if ( EnvGetResetGlobals( m_cobj ) )
+    for ( std::vector<void*>::iterator g = m_reset_globals.begin(); g != m_reset_globals.end(); ++g )
+      QSetDefglobalValue( m_cobj, static_cast<struct defglobal*>( *g ), NULL, TRUE );
+
+  for ( std::vector<void*>::iterator f = m_reset_facts.begin(); f != m_reset_facts.end(); ++f ) {
+    if ( EnvFactExistp( m_cobj, *f ) )
+      continue;
+    struct fact* source = static_cast<struct fact*>( *f );
+    struct fact* copy = EnvCreateFact( m_cobj, EnvFactDeftemplate( m_cobj, *f ) );
+    for ( long int i = 0; i < source->theProposition.multifieldLength; ++i ) {
+      const struct field& from = source->theProposition.theFields[i];
+      struct field& to = copy->theProposition.theFields[i];
+      to.type = from.type;
+      to.value = ( from.type == MULTIFIELD ) ? copy_multifield( m_cobj, from.value, 1, GetMFLength( from.value ) ) : from.value;
+    }
+    void* asserted = EnvAssert( m_cobj, copy );
+    EnvDecrementFactCount( m_cobj, *f );
+    if ( asserted )
+      EnvIncrementFactCount( m_cobj, asserted );
+    *f = asserted;
+  }
+  m_reset_facts.erase( std::remove( m_reset_facts.begin(), m_reset_facts.end(), (void*)NULL ), m_reset_facts.end() );
+
+  for ( std::vector<void*>::iterator r = m_reset_rules.begin(); r != m_reset_rules.end(); ++r )
+    EnvRefresh( m_cobj, *r );
+
+  m_signal_reset.emit();
+}
+
+void Environment::discard_reset_snapshot()
+{
+  for ( std::vector<void*>::iterator f = m_reset_facts.begin(); f != m_reset_facts.end(); ++f )
+    EnvDecrementFactCount( m_cobj, *f );
+  m_reset_facts.clear();
+  m_reset_globals.clear();
+  m_reset_rules.clear();
+  m_reset_constructs.clear();
+  m_reset_snapshot = false;
+}
+
 bool Environment::save( const std::string& filename )
 {
   return EnvSave( m_cobj, filename.c_str() );
@@ -131,7 +1380,9 @@ long int Environment::run( long int runlimit )
 {
   long int executed;
   m_mutex_run.lock(); // Grab the lock before running
+  update_callbacks();
   executed = EnvRun( m_cobj, runlimit ); // Run CLIPS
+  code_ran();
   m_mutex_run_signal.lock(); // Lock the emit signal to guarantee that another run doesn't emit first
   m_mutex_run.unlock(); // Unlock the run, because we have the signal lock
   m_signal_run.emit(executed); // Emit the signal for this run
@@ -139,24 +1390,37 @@ long int Environment::run( long int runlimit )
   return executed;
 }
 
-void Environment::run_threaded( long int runlimit, int priority ) {
+bool Environment::run_threaded( long int runlimit, int priority ) {
   // No matter what, let's start by grabbing the run queue lock
   // If we have it here, we can safely test for the run lock next because we would
   // stall the thread before it does it's while() check
   m_mutex_run_queue.lock();
   if ( m_mutex_threaded_run.trylock() ) {
-    m_run_queue.push( Job( priority, runlimit ) );
+    enqueue_job( Job( priority, runlimit ) );
     m_mutex_run.lock();
     // Will enter thread with run queue, threaded run, and run locks
-    m_run_thread = Glib::Thread::create( sigc::mem_fun(*this, &Environment::threaded_run), true );
+    try {
+      m_run_thread = Glib::Thread::create( sigc::mem_fun(*this, &Environment::threaded_run), true );
+    } catch ( Glib::ThreadError& ) {
+      // No thread was running, so the queue holds only this job
+      m_run_queue.clear();
+      m_mutex_run.unlock();
+      m_mutex_threaded_run.unlock();
+      m_mutex_run_queue.unlock();
+      return false;
+    }
     // But, this function is done and will return, with the locks safely in the hands of the thread
-    return;
+    return true;
   } else {
     // If we got here, then a thread is already running, we have the queue
     // so, push on the new job
-    m_run_queue.push( Job( priority, runlimit ) );
+    enqueue_job( Job( priority, runlimit ) );
+    // Preempt the current job if the new one is more important, the
+    // execution thread halts at the next rule boundary
+    if ( m_job_active && priority > m_active_priority )
+      m_preempt_requested = true;
     m_mutex_run_queue.unlock();
-    return;
+    return true;
   }
 }
 
@@ -184,19 +1448,116 @@ sigc::signal<void,long int> Environment::signal_run() {
   return m_signal_run;
 }
 
+void Environment::enqueue_job( const Job& job ) {
+  // The run queue mutex is held by the caller
+  RunQueue::iterator queued = m_run_queue.find( job.priority );
+  if ( queued == m_run_queue.end() )
+    m_run_queue.insert( std::make_pair( job.priority, job ) );
+  else
+    queued->second.coalesce( job );
+}
+
+int Environment::notification_fd() {
+  m_mutex_run_queue.lock();
+  if ( m_notify_fd[0] == -1 ) {
+#ifdef CLIPSMM_HAVE_SYS_EVENTFD_H
+    m_notify_fd[0] = m_notify_fd[1] = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+#else
+    if ( pipe( m_notify_fd ) == 0 ) {
+      for ( int i = 0; i < 2; ++i ) {
+        fcntl( m_notify_fd[i], F_SETFL, fcntl( m_notify_fd[i], F_GETFL ) | O_NONBLOCK );
+        fcntl( m_notify_fd[i], F_SETFD, FD_CLOEXEC );
+      }
+    } else {
+      m_notify_fd[0] = m_notify_fd[1] = -1;
+    }
+#endif
+  }
+  int fd = m_notify_fd[0];
+  m_mutex_run_queue.unlock();
+  return fd;
+}
+
+std::vector<Environment::RunCompletion> Environment::poll_completions() {
+  std::vector<RunCompletion> completions;
+
+  // Drain the descriptor and take the records at once, the execution thread
+  // records and signals completions under the same lock
+  m_mutex_run_queue.lock();
+  if ( m_notify_fd[0] != -1 ) {
+#ifdef CLIPSMM_HAVE_SYS_EVENTFD_H
+    eventfd_t value;
+    eventfd_read( m_notify_fd[0], &value );
+#else
+    char buf[64];
+    while ( read( m_notify_fd[0], buf, sizeof(buf) ) > 0 ) { }
+#endif
+  }
+  completions.swap( m_completions );
+  m_mutex_run_queue.unlock();
+  return completions;
+}
+
+void Environment::push_completion( const RunCompletion& completion ) {
+  // The run queue mutex is held by the caller
+  if ( m_completions.size() >= MAX_PENDING_COMPLETIONS ) {
+    // Nobody polls, merge into the latest pending completion of the priority
+    for ( std::vector<RunCompletion>::reverse_iterator c = m_completions.rbegin(); c != m_completions.rend(); ++c ) {
+      if ( c->priority == completion.priority ) {
+        c->executed += completion.executed;
+        c->coalesced += completion.coalesced + 1;
+        if ( completion.latency > c->latency ) c->latency = completion.latency;
+        return;
+      }
+    }
+  }
+  m_completions.push_back( completion );
+}
+
+Environment::RunStatistics::RunStatistics():
+  jobs(0), preemptions(0), coalesced(0),
+  total_wait(0.0), max_wait(0.0),
+  total_latency(0.0), max_latency(0.0)
+{
+}
+
+std::map<int, Environment::RunStatistics> Environment::run_statistics() {
+  m_mutex_run_queue.lock();
+  std::map<int, RunStatistics> stats = m_run_statistics;
+  m_mutex_run_queue.unlock();
+  return stats;
+}
+
+void Environment::reset_run_statistics() {
+  m_mutex_run_queue.lock();
+  m_run_statistics.clear();
+  m_mutex_run_queue.unlock();
+}
+
 void Environment::threaded_run() {
   long int executed;
-  long int current_runlimit;
 
   // We have the run queue, threaded run, and run locks here
   while ( m_run_queue.size() > 0 ) {
-    current_runlimit = m_run_queue.top().runlimit;
-    m_run_queue.pop();
+    Job job = m_run_queue.begin()->second;
+    m_run_queue.erase( m_run_queue.begin() );
+
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    RunStatistics& stats = m_run_statistics[job.priority];
+    job.waiting.account( now, stats.total_wait, stats.max_wait );
+    job.waiting = QueueTimes();
+
+    m_job_active = true;
+    m_active_priority = job.priority;
+    // Requests made for a job we already dequeued must not halt this one
+    m_preempt_requested = false;
 
     // We have the top job, let's release the queue until we need it again
     m_mutex_run_queue.unlock();
 
-    executed = EnvRun( m_cobj, current_runlimit ); // Run CLIPS
+    update_callbacks();
+    executed = EnvRun( m_cobj, job.runlimit ); // Run CLIPS
+    code_ran();
 
     m_mutex_run_signal.lock(); // Grab the signal lock, signal and release it
     m_signal_run.emit(executed);
@@ -204,6 +1565,42 @@ void Environment::threaded_run() {
 
     // Make sure the queue is locked again while we check the size
     m_mutex_run_queue.lock();
+    m_job_active = false;
+
+    bool preempted = m_preempt_requested.exchange(false);
+    SetHaltRules( m_cobj, FALSE );
+
+    long int remaining = ( job.runlimit < 0 ) ? -1 : job.runlimit - executed;
+    if ( preempted && remaining != 0 && EnvGetNextActivation( m_cobj, NULL ) != NULL ) {
+      // Re-queue the remainder, it keeps its queue times
+      job.runlimit = remaining;
+      job.executed += executed;
+      m_run_statistics[job.priority].preemptions += 1;
+      enqueue_job( job );
+    } else {
+      std::chrono::steady_clock::time_point done = std::chrono::steady_clock::now();
+      RunStatistics& done_stats = m_run_statistics[job.priority];
+      done_stats.jobs += 1;
+      done_stats.coalesced += job.coalesced;
+
+      job.queued.account( done, done_stats.total_latency, done_stats.max_latency );
+      double latency = std::chrono::duration<double>( done - job.queued.earliest ).count();
+
+      if ( m_notify_fd[1] != -1 ) {
+        RunCompletion completion;
+        completion.priority = job.priority;
+        completion.executed = job.executed + executed;
+        completion.coalesced = job.coalesced;
+        completion.latency = latency;
+        push_completion( completion );
+#ifdef CLIPSMM_HAVE_SYS_EVENTFD_H
+        eventfd_write( m_notify_fd[1], 1 );
+#else
+        char c = 0;
+        if ( write( m_notify_fd[1], &c, 1 ) == -1 ) { } // pipe full, already readable
+#endif
+      }
+    }
   }
 
   // Here, we still have the queue lock, so we can start releasing the other locks
@@ -294,31 +1691,191 @@ DefaultFacts::pointer Environment::get_default_facts( const std::string & defaul
 
 std::vector< std::string > Environment::get_default_facts_names( )
 {
-  DATA_OBJECT clipsdo;
-  EnvGetDeffactsList( m_cobj, &clipsdo, NULL );
-  return data_object_to_strings( clipsdo );
+  return construct_names( CONSTRUCT_DEFAULT_FACTS, NULL );
 }
 
 std::vector<std::string> Environment::get_default_facts_names(const Module& module) {
-  DATA_OBJECT clipsdo;
-  if ( module.cobj() ) {
-    EnvGetDeffactsList( m_cobj, &clipsdo, module.cobj() );
-    return data_object_to_strings( clipsdo );
-  }
+  if ( module.cobj() )
+    return construct_names( CONSTRUCT_DEFAULT_FACTS, module.cobj() );
   else
     return std::vector<std::string>();
 }
 
 std::vector<std::string> Environment::get_default_facts_names(Module::pointer module) {
-  DATA_OBJECT clipsdo;
-  if ( module && module->cobj() ) {
-    EnvGetDeffactsList( m_cobj, &clipsdo, module->cobj() );
-    return data_object_to_strings( clipsdo );
-  }
+  if ( module && module->cobj() )
+    return construct_names( CONSTRUCT_DEFAULT_FACTS, module->cobj() );
   else
     return std::vector<std::string>();
 }
 
+std::vector<std::string> Environment::get_construct_names( ConstructType type, Module::pointer module )
+{
+  if ( module && ! module->cobj() )
+    return std::vector<std::string>();
+  return construct_names( type, module ? module->cobj() : NULL );
+}
+
+const std::vector<std::string>& Environment::construct_names( ConstructType type, void* module )
+{
+  if ( m_construct_names_generation != m_construct_generation ) {
+    m_construct_names.clear();
+    m_construct_names_generation = m_construct_generation;
+  }
+
+  ConstructListing& listing = m_construct_names[std::make_pair( type, module )];
+  if ( listing.valid && listing.code_generation == m_code_generation )
+    return listing.names;
+
+  // CLIPS code ran since, the listing is kept if the constructs are the same
+  std::vector<const void*> signature;
+  construct_signature( type, module, signature );
+  listing.code_generation = m_code_generation;
+  if ( ! listing.valid || signature != listing.signature ) {
+    DATA_OBJECT clipsdo;
+    switch ( type ) {
+      case CONSTRUCT_RULE:
+        EnvGetDefruleList( m_cobj, &clipsdo, module );
+        break;
+      case CONSTRUCT_TEMPLATE:
+        EnvGetDeftemplateList( m_cobj, &clipsdo, module );
+        break;
+      case CONSTRUCT_FUNCTION:
+        EnvGetDeffunctionList( m_cobj, &clipsdo, (defmodule*)module );
+        break;
+      case CONSTRUCT_GLOBAL:
+        EnvGetDefglobalList( m_cobj, &clipsdo, module );
+        break;
+      case CONSTRUCT_DEFAULT_FACTS:
+        EnvGetDeffactsList( m_cobj, &clipsdo, module );
+        break;
+    }
+    listing.names = data_object_to_strings( clipsdo );
+    listing.signature.swap( signature );
+    listing.valid = true;
+  }
+  return listing.names;
+}
+
+void* Environment::next_construct( ConstructType type, void* construct )
+{
+  switch ( type ) {
+    case CONSTRUCT_RULE:
+      return EnvGetNextDefrule( m_cobj, construct );
+    case CONSTRUCT_TEMPLATE:
+      return EnvGetNextDeftemplate( m_cobj, construct );
+    case CONSTRUCT_FUNCTION:
+      return EnvGetNextDeffunction( m_cobj, construct );
+    case CONSTRUCT_GLOBAL:
+      return EnvGetNextDefglobal( m_cobj, construct );
+    case CONSTRUCT_DEFAULT_FACTS:
+      return EnvGetNextDeffacts( m_cobj, construct );
+  }
+  return NULL;
+}
+
+const char* Environment::construct_name( ConstructType type, void* construct )
+{
+  switch ( type ) {
+    case CONSTRUCT_RULE:
+      return EnvGetDefruleName( m_cobj, construct );
+    case CONSTRUCT_TEMPLATE:
+      return EnvGetDeftemplateName( m_cobj, construct );
+    case CONSTRUCT_FUNCTION:
+      return EnvGetDeffunctionName( m_cobj, construct );
+    case CONSTRUCT_GLOBAL:
+      return EnvGetDefglobalName( m_cobj, construct );
+    case CONSTRUCT_DEFAULT_FACTS:
+      return EnvGetDeffactsName( m_cobj, construct );
+  }
+  return NULL;
+}
+
+void Environment::construct_signature( ConstructType type, void* module, std::vector<const void*>& signature )
+{
+  // A construct freed and another one allocated in its place would have
+  // to reuse the name's memory as well to go unnoticed
+  signature.clear();
+  void* current = EnvGetCurrentModule( m_cobj );
+  void* m = module ? module : EnvGetNextDefmodule( m_cobj, NULL );
+  for ( ; m; m = module ? NULL : EnvGetNextDefmodule( m_cobj, m ) ) {
+    EnvSetCurrentModule( m_cobj, m );
+    for ( void* c = next_construct( type, NULL ); c; c = next_construct( type, c ) ) {
+      signature.push_back( c );
+      signature.push_back( construct_name( type, c ) );
+    }
+  }
+  EnvSetCurrentModule( m_cobj, current );
+}
+
+void Environment::visit_constructs( ConstructType type, const sigc::slot<void, const char*, const char*>& visitor,
+                                    Module::pointer module )
+{
+  if ( module && ! module->cobj() )
+    return;
+
+  void* current = EnvGetCurrentModule( m_cobj );
+  void* m = module ? module->cobj() : EnvGetNextDefmodule( m_cobj, NULL );
+  for ( ; m; m = module ? NULL : EnvGetNextDefmodule( m_cobj, m ) ) {
+    EnvSetCurrentModule( m_cobj, m );
+    const char* module_name = EnvGetDefmoduleName( m_cobj, m );
+    for ( void* c = next_construct( type, NULL ); c; c = next_construct( type, c ) )
+      visitor( module_name, construct_name( type, c ) );
+  }
+  EnvSetCurrentModule( m_cobj, current );
+}
+
+void Environment::constructs_changed()
+{
+  ++m_construct_generation;
+}
+
+void Environment::check_handles()
+{
+  if ( m_handles_generation == m_construct_generation )
+    return;
+  m_template_handles.clear();
+  m_rule_handles.clear();
+  m_global_handles.clear();
+  m_function_handles.clear();
+  m_handles_generation = m_construct_generation;
+}
+
+void* Environment::find_construct( ConstructType type, const std::string& name )
+{
+  switch ( type ) {
+    case CONSTRUCT_RULE:
+      return EnvFindDefrule( m_cobj, name.c_str() );
+    case CONSTRUCT_TEMPLATE:
+      return EnvFindDeftemplate( m_cobj, name.c_str() );
+    case CONSTRUCT_FUNCTION:
+      return EnvFindDeffunction( m_cobj, name.c_str() );
+    case CONSTRUCT_GLOBAL:
+      return EnvFindDefglobal( m_cobj, name.c_str() );
+    case CONSTRUCT_DEFAULT_FACTS:
+      return EnvFindDeffacts( m_cobj, name.c_str() );
+  }
+  return NULL;
+}
+
+template <class T>
+typename T::pointer Environment::shared_handle( std::map<std::string, ConstructHandle<T> >& handles,
+                                                ConstructType type, const std::string& name )
+{
+  check_handles();
+  ConstructHandle<T>& handle = handles[name];
+  if ( handle.wrapper && handle.code_generation == m_code_generation )
+    return handle.wrapper;
+
+  // Unknown, or CLIPS code may have undefined or redefined it since
+  void* construct = find_construct( type, name );
+  if ( ! construct )
+    handle.wrapper.reset();
+  else if ( ! handle.wrapper || handle.wrapper->cobj() != construct )
+    handle.wrapper = T::create( *this, construct );
+  handle.code_generation = m_code_generation;
+  return handle.wrapper;
+}
+
 DefaultFacts::pointer Environment::get_default_facts_list_head( )
 {
   void* df;
@@ -334,37 +1891,24 @@ Template::pointer Environment::get_template( const std::string & template_name )
   if ( ! m_cobj )
     return Template::pointer();
 
-  void* tem = EnvFindDeftemplate( m_cobj, template_name.c_str() );
-
-  if ( !tem )
-    return Template::pointer();
-
-  return Template::create( *this, tem );
+  return shared_handle( m_template_handles, CONSTRUCT_TEMPLATE, template_name );
 }
 
 std::vector< std::string > Environment::get_template_names( )
 {
-  DATA_OBJECT clipsdo;
-  EnvGetDeftemplateList( m_cobj, &clipsdo, NULL );
-  return data_object_to_strings( clipsdo );
+  return construct_names( CONSTRUCT_TEMPLATE, NULL );
 }
 
 std::vector<std::string> Environment::get_template_names(const Module& module) {
-  DATA_OBJECT clipsdo;
-  if ( module.cobj() ) {
-    EnvGetDeftemplateList( m_cobj, &clipsdo, module.cobj() );
-    return data_object_to_strings( clipsdo );
-  }
+  if ( module.cobj() )
+    return construct_names( CONSTRUCT_TEMPLATE, module.cobj() );
   else
     return std::vector<std::string>();
 }
 
 std::vector<std::string> Environment::get_template_names(Module::pointer module) {
-  DATA_OBJECT clipsdo;
-  if ( module && module->cobj() ) {
-    EnvGetDeftemplateList( m_cobj, &clipsdo, module->cobj() );
-    return data_object_to_strings( clipsdo );
-  }
+  if ( module && module->cobj() )
+    return construct_names( CONSTRUCT_TEMPLATE, module->cobj() );
   else
     return std::vector<std::string>();
 }
@@ -381,37 +1925,24 @@ Template::pointer Environment::get_template_list_head( )
 
 Rule::pointer Environment::get_rule( const std::string & rule_name )
 {
-  void* rule;
-  rule = EnvFindDefrule( m_cobj, rule_name.c_str() );
-  if ( rule )
-    return Rule::create( *this, rule );
-  else
-    return Rule::pointer();
+  return shared_handle( m_rule_handles, CONSTRUCT_RULE, rule_name );
 }
 
 std::vector< std::string > Environment::get_rule_names( )
 {
-  DATA_OBJECT clipsdo;
-  EnvGetDefruleList( m_cobj, &clipsdo, NULL );
-  return data_object_to_strings( clipsdo );
+  return construct_names( CONSTRUCT_RULE, NULL );
 }
 
 std::vector<std::string> Environment::get_rule_names(const Module& module) {
-  DATA_OBJECT clipsdo;
-  if ( module.cobj() ) {
-    EnvGetDefruleList( m_cobj, &clipsdo, module.cobj() );
-    return data_object_to_strings( clipsdo );
-  }
+  if ( module.cobj() )
+    return construct_names( CONSTRUCT_RULE, module.cobj() );
   else
     return std::vector<std::string>();
 }
 
 std::vector<std::string> Environment::get_rule_names(Module::pointer module) {
-  DATA_OBJECT clipsdo;
-  if ( module && module->cobj() ) {
-    EnvGetDefruleList( m_cobj, &clipsdo, module->cobj() );
-    return data_object_to_strings( clipsdo );
-  }
+  if ( module && module->cobj() )
+    return construct_names( CONSTRUCT_RULE, module->cobj() );
   else
     return std::vector<std::string>();
 }
@@ -429,6 +1960,7 @@ Rule::pointer Environment::get_rule_list_head( )
 void Environment::remove_rules( )
 {
   EnvUndefrule( m_cobj, NULL );
+  constructs_changed();
 }
 
 Fact::pointer Environment::assert_fact( const std::string& factstring )
@@ -471,6 +2003,14 @@ Fact::pointer Environment::assert_fact_f(const char *format, ...)
   }
 }
 
+AssertPattern::pointer Environment::prepare_assert( const std::string& pattern )
+{
+  AssertPattern::pointer prepared = AssertPattern::create( *this, pattern );
+  if ( ! prepared->is_valid() )
+    return AssertPattern::pointer();
+  return prepared;
+}
+
 bool Environment::incremental_reset_enabled( )
 {
   return EnvGetIncrementalReset( m_cobj );
@@ -527,6 +2067,37 @@ Activation::pointer Environment::get_activation_list_head( )
     return Activation::pointer();
 }
 
+std::vector<ActivationInfo> Environment::agenda_snapshot( Module::pointer module )
+{
+  std::vector<ActivationInfo> snapshot;
+  agenda_snapshot( snapshot, module );
+  return snapshot;
+}
+
+void Environment::agenda_snapshot( std::vector<ActivationInfo>& snapshot, Module::pointer module )
+{
+  snapshot.clear();
+  if ( module && ! module->cobj() )
+    return;
+
+  // EnvGetNextActivation() walks the agenda of the current module
+  void* current = EnvGetCurrentModule( m_cobj );
+  void* m = module ? module->cobj() : EnvGetNextDefmodule( m_cobj, NULL );
+  for ( ; m; m = module ? NULL : EnvGetNextDefmodule( m_cobj, m ) ) {
+    EnvSetCurrentModule( m_cobj, m );
+    ActivationInfo info;
+    info.module = EnvGetDefmoduleName( m_cobj, m );
+    for ( void* a = EnvGetNextActivation( m_cobj, NULL ); a; a = EnvGetNextActivation( m_cobj, a ) ) {
+      struct activation* activation = static_cast<struct activation*>( a );
+      info.rule = EnvGetDefruleName( m_cobj, activation->theRule );
+      info.salience = activation->salience;
+      info.timetag = activation->timetag;
+      snapshot.push_back( info );
+    }
+  }
+  EnvSetCurrentModule( m_cobj, current );
+}
+
 void Environment::refresh_agenda() {
   EnvRefreshAgenda( m_cobj, NULL );
 }
@@ -596,45 +2167,248 @@ Values Environment::evaluate( const std::string& expression )
 {
   DATA_OBJECT clipsdo;
   int result;
+  update_callbacks();
   result = EnvEval( m_cobj, expression.c_str(), &clipsdo );
+  code_ran();
   if ( result )
     return data_object_to_values( clipsdo );
   else
     return Values();
 }
 
+Values Environment::call( const std::string& function_name, const Values& arguments )
+{
+  return call( function_name, arguments.empty() ? NULL : &arguments[0], arguments.size() );
+}
+
+Values Environment::call( const std::string& function_name, const Value* arguments, std::size_t num_arguments )
+{
+  unsigned short call_type = FCALL;
+  void* target = NULL;
+
+  std::map<std::string, void*>::iterator f = m_call_functions.find( function_name );
+  if ( f != m_call_functions.end() ) {
+    target = f->second;
+  } else if ( ( target = FindFunction( m_cobj, function_name.c_str() ) ) != NULL ) {
+    m_call_functions[function_name] = target;
+  } else if ( ( target = EnvFindDeffunction( m_cobj, function_name.c_str() ) ) != NULL ) {
+    call_type = PCALL;
+  } else if ( ( target = EnvFindDefgeneric( m_cobj, function_name.c_str() ) ) != NULL ) {
+    call_type = GCALL;
+  } else {
+    return Values();
+  }
+
+  struct expr* top = GenConstant( m_cobj, call_type, target );
+  struct expr* last = NULL;
+  for ( std::size_t i = 0; i < num_arguments; ++i ) {
+    DATA_OBJECT clipsdo;
+    value_to_data_object_rawenv( m_cobj, arguments[i], &clipsdo );
+    struct expr* arg = GenConstant( m_cobj, GetType( clipsdo ), GetValue( clipsdo ) );
+    if ( last ) last->nextArg = arg;
+    else top->argList = arg;
+    last = arg;
+  }
+
+  // Function calls are checked against the restrictions by the parser
+  if ( call_type == FCALL ) {
+    struct FunctionDefinition* fdef = static_cast<struct FunctionDefinition*>( target );
+    if ( CheckExpressionAgainstRestrictions( m_cobj, top, fdef->restrictions, function_name.c_str() ) ) {
+      ReturnExpression( m_cobj, top );
+      return Values();
+    }
+  }
+
+  update_callbacks();
+  begin_evaluation();
+  EnvSetEvaluationError( m_cobj, FALSE );
+
+  DATA_OBJECT clipsdo;
+  ExpressionInstall( m_cobj, top );
+  EvaluateExpression( m_cobj, top, &clipsdo );
+  ExpressionDeinstall( m_cobj, top );
+  ReturnExpression( m_cobj, top );
+  code_ran();
+
+  if ( EnvGetEvaluationError( m_cobj ) )
+    return Values();
+  return data_object_to_values( clipsdo );
+}
+
+Expression::pointer Environment::prepare( const std::string& expression )
+{
+  void* top = parse_expression( expression );
+  if ( top == NULL )
+    return Expression::pointer();
+  return Expression::create( *this, top, expression );
+}
+
+std::size_t Environment::evaluate_batch( const std::vector<std::string>& expressions,
+                                         std::vector<EvaluationResult>& results )
+{
+  std::size_t succeeded = 0;
+  results.resize( expressions.size() );
+  update_callbacks();
+  begin_evaluation();
+
+  for ( std::size_t i = 0; i < expressions.size(); ++i ) {
+    EvaluationResult& result = results[i];
+    result.values.clear();
+    result.ok = false;
+
+    struct expr* top = static_cast<struct expr*>( parse_expression( expressions[i] ) );
+    if ( top == NULL )
+      continue;
+
+    // An error in an earlier expression must not halt this one
+    DATA_OBJECT clipsdo;
+    SetHaltExecution( m_cobj, FALSE );
+    EnvSetEvaluationError( m_cobj, FALSE );
+    EvaluateExpression( m_cobj, top, &clipsdo );
+    result.ok = ! EnvGetEvaluationError( m_cobj );
+    if ( result.ok ) {
+      data_object_to_values( clipsdo, result.values );
+      ++succeeded;
+    }
+    ExpressionDeinstall( m_cobj, top );
+    ReturnExpression( m_cobj, top );
+  }
+  code_ran();
+  return succeeded;
+}
+
+std::size_t Environment::evaluate_batch( const std::vector<Expression::pointer>& expressions,
+                                         std::vector<EvaluationResult>& results )
+{
+  std::size_t succeeded = 0;
+  results.resize( expressions.size() );
+  update_callbacks();
+  begin_evaluation();
+
+  for ( std::size_t i = 0; i < expressions.size(); ++i ) {
+    EvaluationResult& result = results[i];
+    SetHaltExecution( m_cobj, FALSE );
+    result.ok = expressions[i] && expressions[i]->evaluate_prepared( result.values );
+    if ( result.ok )
+      ++succeeded;
+  }
+  code_ran();
+  return succeeded;
+}
+
+void* Environment::parse_expression( const std::string& expression )
+{
+  const char* logical_name = "clipsmm-prepare";
+  if ( OpenStringSource( m_cobj, logical_name, expression.c_str(), 0 ) == 0 )
+    return NULL;
+
+  // Same parser setup as EnvEval()
+  int pp_buffer_status = GetPPBufferStatus( m_cobj );
+  SetPPBufferStatus( m_cobj, FALSE );
+  void* bind_names = GetParsedBindNames( m_cobj );
+  SetParsedBindNames( m_cobj, NULL );
+
+  struct expr* top = ParseAtomOrExpression( m_cobj, logical_name, NULL );
+
+  SetPPBufferStatus( m_cobj, pp_buffer_status );
+  ClearParsedBindNames( m_cobj );
+  SetParsedBindNames( m_cobj, bind_names );
+  CloseStringSource( m_cobj, logical_name );
+
+  if ( top != NULL )
+    ExpressionInstall( m_cobj, top );
+  return top;
+}
+
+void Environment::begin_evaluation()
+{
+  // Mirrors the top level setup of EnvEval()
+  if ( EvaluationData( m_cobj )->CurrentExpression == NULL ) {
+    PeriodicCleanup( m_cobj, TRUE, FALSE );
+    SetHaltExecution( m_cobj, FALSE );
+  }
+}
+
+void Environment::invalidate_prepared()
+{
+  std::set<Expression*> expressions;
+  expressions.swap( m_expressions );
+  std::set<Expression*>::iterator i;
+  for ( i = expressions.begin(); i != expressions.end(); ++i )
+    ( *i )->invalidate();
+
+  std::set<AssertPattern*> patterns;
+  patterns.swap( m_assert_patterns );
+  std::set<AssertPattern*>::iterator p;
+  for ( p = patterns.begin(); p != patterns.end(); ++p )
+    ( *p )->invalidate();
+}
+
 Values Environment::function( const std::string & function_name,
                               const std::string & arguments )
 {
   DATA_OBJECT clipsdo;
   int result;
+  update_callbacks();
   result = EnvFunctionCall( m_cobj,
                             function_name.c_str(),
                             arguments.c_str(),
                             &clipsdo);
+  code_ran();
   if ( !result )
     return data_object_to_values( clipsdo );
   else
     return Values();
 }
 
+bool Environment::define_function( const std::string& name, UserFunction::pointer function )
+{
+  m_slots[name] = function;
+  // CLIPS keeps the name pointer, the map key outlives the registration
+  const char* key = m_slots.find( name )->first.c_str();
+  return EnvDefineFunction2WithContext( m_cobj, key, function->return_code(), function->callback(),
+                                        key, function->restrictions(), function.get() );
+}
+
 bool Environment::remove_function( std::string name )
 {
   bool result = UndefineFunction( m_cobj, name.c_str() );
   m_slots.erase(name);
-  if (m_func_restr.find(name) != m_func_restr.end()) {
-    free(m_func_restr[name]);
-    m_func_restr.erase(name);
-  }
+  m_call_functions.erase(name);
   return result;
 }
 
+void Environment::enable_function_profiling( bool enable )
+{
+  m_function_profiling = enable;
+  std::map<std::string, UserFunction::pointer>::iterator i;
+  for ( i = m_slots.begin(); i != m_slots.end(); ++i )
+    i->second->set_profiling( enable );
+}
+
+bool Environment::function_profiling_enabled() const
+{
+  return m_function_profiling;
+}
+
+std::map<std::string, FunctionStats> Environment::function_stats() const
+{
+  std::map<std::string, FunctionStats> stats;
+  std::map<std::string, UserFunction::pointer>::const_iterator i;
+  for ( i = m_slots.begin(); i != m_slots.end(); ++i )
+    stats[i->first] = i->second->stats();
+  return stats;
+}
+
+void Environment::reset_function_stats()
+{
+  std::map<std::string, UserFunction::pointer>::iterator i;
+  for ( i = m_slots.begin(); i != m_slots.end(); ++i )
+    i->second->reset_stats();
+}
+
 Global::pointer Environment::get_global( const std::string& global_name ) {
-  void* clips_global = EnvFindDefglobal( m_cobj, global_name.c_str());
-  if ( clips_global )
-    return Global::create( *this, clips_global );
-  else
-    return Global::pointer();
+  return shared_handle( m_global_handles, CONSTRUCT_GLOBAL, global_name );
 }
 
 Global::pointer Environment::get_global_list_head( )
@@ -649,39 +2423,27 @@ Global::pointer Environment::get_global_list_head( )
 
 std::vector<std::string> Environment::get_globals_names()
 {
-  DATA_OBJECT clipsdo;
-  EnvGetDefglobalList( m_cobj, &clipsdo, NULL );
-  return data_object_to_strings( clipsdo );
+  return construct_names( CONSTRUCT_GLOBAL, NULL );
 }
 
 std::vector<std::string> Environment::get_globals_names( const Module& module )
 {
-  DATA_OBJECT clipsdo;
-  if ( module.cobj() ) {
-    EnvGetDefglobalList( m_cobj, &clipsdo, module.cobj() );
-    return data_object_to_strings( clipsdo );
-  }
+  if ( module.cobj() )
+    return construct_names( CONSTRUCT_GLOBAL, module.cobj() );
   else
     return std::vector<std::string>();
 }
 
 std::vector<std::string> Environment::get_globals_names( Module::pointer module )
 {
-  DATA_OBJECT clipsdo;
-  if ( module && module->cobj() ) {
-    EnvGetDefglobalList( m_cobj, &clipsdo, module->cobj() );
-    return data_object_to_strings( clipsdo );
-  }
+  if ( module && module->cobj() )
+    return construct_names( CONSTRUCT_GLOBAL, module->cobj() );
   else
     return std::vector<std::string>();
 }
 
 Function::pointer Environment::get_function( const std::string& function_name ) {
-  void* clips_function = EnvFindDeffunction( m_cobj, function_name.c_str());
-  if ( clips_function )
-    return Function::create( *this, clips_function );
-  else
-    return Function::pointer();
+  return shared_handle( m_function_handles, CONSTRUCT_FUNCTION, function_name );
 }
 
 Function::pointer Environment::get_function_list_head( )
@@ -696,29 +2458,21 @@ Function::pointer Environment::get_function_list_head( )
 
 std::vector<std::string> Environment::get_function_names()
 {
-  DATA_OBJECT clipsdo;
-  EnvGetDeffunctionList( m_cobj, &clipsdo, NULL );
-  return data_object_to_strings( clipsdo );
+  return construct_names( CONSTRUCT_FUNCTION, NULL );
 }
 
 std::vector<std::string> Environment::get_function_names( const Module& module )
 {
-  DATA_OBJECT clipsdo;
-  if ( module.cobj() ) {
-    EnvGetDeffunctionList( m_cobj, &clipsdo, (defmodule*)(module.cobj()) );
-    return data_object_to_strings( clipsdo );
-  }
+  if ( module.cobj() )
+    return construct_names( CONSTRUCT_FUNCTION, module.cobj() );
   else
     return std::vector<std::string>();
 }
 
 std::vector<std::string> Environment::get_function_names( Module::pointer module )
 {
-  DATA_OBJECT clipsdo;
-  if ( module && module->cobj() ) {
-    EnvGetDeffunctionList( m_cobj, &clipsdo, (defmodule*)(module->cobj()) );
-    return data_object_to_strings( clipsdo );
-  }
+  if ( module && module->cobj() )
+    return construct_names( CONSTRUCT_FUNCTION, module->cobj() );
   else
     return std::vector<std::string>();
 }
@@ -773,8 +2527,40 @@ sigc::signal< void > Environment::signal_globals_changed()
   return m_signal_globals_changed;
 }
 
+void Environment::update_callbacks()
+{
+  bool want_periodic = ! m_signal_periodic.empty();
+  if ( want_periodic != m_periodic_callback_installed ) {
+    if ( want_periodic ) {
+      if ( EnvAddPeriodicFunction( m_cobj, (char *)"clipsmm_periodic_callback", Environment::periodic_callback, 2001 ) == 0 )
+        throw std::logic_error("clipsmm: Error adding periodic callback to clips environment");
+    } else {
+      EnvRemovePeriodicFunction( m_cobj, (char *)"clipsmm_periodic_callback" );
+    }
+    m_periodic_callback_installed = want_periodic;
+  }
+
+  bool want_rule_firing = ! m_signal_rule_firing.empty();
+  if ( want_rule_firing != m_rule_firing_callback_installed ) {
+    if ( want_rule_firing ) {
+      if ( EnvAddRunFunction( m_cobj, (char *)"clipsmm_rule_firing_callback", Environment::rule_firing_callback, 2001 ) == 0 )
+        throw std::logic_error("clipsmm: Error adding rule firing callback to clips environment");
+    } else {
+      EnvRemoveRunFunction( m_cobj, (char *)"clipsmm_rule_firing_callback" );
+    }
+    m_rule_firing_callback_installed = want_rule_firing;
+  }
+}
+
 void Environment::clear_callback( void * env )
 {
+  // Runs before the constructs are removed, prepared expressions and patterns refer to them
+  m_environment_map[env]->invalidate_prepared();
+  m_environment_map[env]->discard_reset_snapshot();
+  m_environment_map[env]->m_tracked_files.clear();
+  m_environment_map[env]->m_tracked_order.clear();
+  m_environment_map[env]->m_construct_generation += 1;
+  m_environment_map[env]->check_handles();
   m_environment_map[env]->m_signal_clear.emit();
 }
 
@@ -793,6 +2579,12 @@ void Environment::rule_firing_callback( void * env )
   m_environment_map[env]->m_signal_rule_firing.emit();
 }
 
+void Environment::preempt_callback( void * env )
+{
+  if ( m_environment_map[env]->m_preempt_requested.load( std::memory_order_relaxed ) )
+    SetHaltRules( env, TRUE );
+}
+
 int Environment::get_arg_count( void* env ) {
   return EnvRtnArgCount( env );
 }
@@ -834,6 +2626,10 @@ void Environment::set_return_values( void *env, void *rv, const Values &v ) {
       SetMFValue(mfptr, mfi,
 		 EnvAddExternalAddress(env, v[i].as_address(), EXTERNAL_ADDRESS));
       break;
+    case TYPE_FACT_ADDRESS:
+      SetMFType(mfptr, mfi, FACT_ADDRESS);
+      SetMFValue(mfptr, mfi, v[i].as_address());
+      break;
     default:
       throw std::logic_error("clipsmm: value type not supported for multifield return value");
     }
@@ -853,6 +2649,23 @@ void Environment::set_return_value( void *env, void *rv, const Value &v)
   value_to_data_object_rawenv(env, v, (struct dataObject *)rv);
 }
 
+void Environment::set_return_value( void *env, void *rv, const Fact::pointer &f )
+{
+  set_return_value( env, rv, f ? FactRef( env, f->cobj() ) : FactRef() );
+}
+
+void Environment::set_return_value( void *env, void *rv, const FactRef &f )
+{
+  DATA_OBJECT_PTR rvptr = static_cast<DATA_OBJECT_PTR>(rv);
+  if ( f ) {
+    SetpType(rvptr, FACT_ADDRESS);
+    SetpValue(rvptr, f.cobj());
+  } else {
+    SetpType(rvptr, SYMBOL);
+    SetpValue(rvptr, EnvFalseSymbol(env));
+  }
+}
+
 void* Environment::add_symbol(void *env, const char* s ) {
   return EnvAddSymbol(env, s);
 }
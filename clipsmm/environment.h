@@ -21,9 +21,12 @@
 
 #include <string>
 #include <map>
+#include <set>
 #include <stdexcept>
-#include <map>
-#include <queue>
+#include <tuple>
+#include <functional>
+#include <atomic>
+#include <chrono>
 
 #include <cstdio>
 
@@ -34,7 +37,9 @@
 #include <clipsmm/object.h>
 
 #include <clipsmm/activation.h>
+#include <clipsmm/assertpattern.h>
 #include <clipsmm/defaultfacts.h>
+#include <clipsmm/expression.h>
 #include <clipsmm/fact.h>
 #include <clipsmm/function.h>
 #include <clipsmm/global.h>
@@ -44,6 +49,7 @@
 
 #include <clipsmm/utility.h>
 #include <clipsmm/any.h>
+#include <clipsmm/userfunction.h>
 
 extern "C" {
   int EnvDefineFunction2WithContext( void *, const char *, int, int ( * ) ( void * ), const char *, const char *, void * );
@@ -80,6 +86,42 @@ namespace CLIPS {
        */
       bool binary_save( const std::string& filename );
 
+      /**
+       * Creates an environment with the same constructs and user functions.
+       * The constructs are transferred as a binary image, which is kept in
+       * memory and reused by further clones until the constructs change.
+       * Each user function is added to the clone with a copy of its
+       * callable. As after binary_load(), constructs cannot be added to the
+       * clone without clearing it first, and a clone cannot be cloned.
+       * @param copy_working_memory if true, facts and global values are
+       * copied, otherwise the clone is in the state after a clear
+       * @return the new environment, or a null pointer if the image could
+       * not be written or loaded
+       */
+      Environment::pointer clone( bool copy_working_memory = false );
+
+      /**
+       * Writes the working memory to a compact binary checkpoint: the
+       * facts with the slot layouts of their templates, the values of all
+       * globals and the focus stack. Symbols and strings are stored once.
+       * The checkpoint is written to a temporary file that is renamed.
+       * @return false if the checkpoint could not be written
+       */
+      bool checkpoint( const std::string& filename );
+
+      /**
+       * Restores a checkpoint into an environment with the same constructs.
+       * Like load-facts, the facts are added to the existing ones, but they
+       * are created through the C API instead of the parser and get new
+       * fact indices. Slots are matched by name, slots missing from the
+       * checkpoint get their defaults. Ordered facts create their implied
+       * templates, facts of other unknown templates and unknown globals are
+       * skipped. The checkpoint is decoded completely before the working
+       * memory is changed, nothing is restored from a damaged one.
+       * @return false if the file could not be read or is not a checkpoint
+       */
+      bool restore( const std::string& filename );
+
       /**
        * Allows a construct to be defined
        * @return false if the construct could not be parsed, true on success
@@ -98,6 +140,43 @@ namespace CLIPS {
        */
       Values evaluate( const std::string& expression );
 
+      /** Result of one expression of evaluate_batch() */
+      struct EvaluationResult {
+        EvaluationResult(): ok( false ) { }
+
+        bool ok; /**< False if the expression could not be parsed or evaluated */
+        Values values; /**< The result, empty on errors */
+      };
+
+      /**
+       * Evaluates a series of expressions in one pass.
+       * The results are stored in the same order in results, which is
+       * resized to the number of expressions. Passing the same results
+       * container to consecutive calls reuses its storage.
+       * @return the number of expressions evaluated successfully
+       */
+      std::size_t evaluate_batch( const std::vector<std::string>& expressions,
+                                  std::vector<EvaluationResult>& results );
+
+      /**
+       * Evaluates a series of prepared expressions in one pass, like
+       * evaluate_batch() for expression strings. Invalid expressions and
+       * expressions with unbound parameters are reported as errors.
+       * @return the number of expressions evaluated successfully
+       */
+      std::size_t evaluate_batch( const std::vector<Expression::pointer>& expressions,
+                                  std::vector<EvaluationResult>& results );
+
+      /**
+       * Parses an expression once for repeated evaluation.
+       * Single-field variables in the expression are parameters that are
+       * bound with Expression::bind(). The expression is invalidated when
+       * the environment is cleared.
+       * @return the prepared expression, or a null pointer if it could
+       * not be parsed
+       */
+      Expression::pointer prepare( const std::string& expression );
+
       /**
        * Evaluates a CLIPS function.
        * If the function could not be evaluated a zero-length vector
@@ -105,6 +184,24 @@ namespace CLIPS {
        */
       Values function( const std::string& function_name, const std::string& arguments=std::string() );
 
+      /**
+       * Calls a function, deffunction or generic function with the given
+       * arguments, without formatting and parsing an argument string.
+       * The function lookup is cached for functions, deffunctions and
+       * generic functions are looked up on each call.
+       * If the function could not be evaluated a zero-length vector
+       * is returned.
+       */
+      Values call( const std::string& function_name, const Values& arguments=Values() );
+
+      /**
+       * Calls a function with typed arguments, e.g. call( "+", 1, 2.5 ).
+       * Each argument is converted to a Value, strings become CLIPS
+       * strings; pass a Value to call with a symbol.
+       */
+      template <typename... T_args>
+      Values call( const std::string& function_name, const T_args&... arguments );
+
       /**
        * Loads a set of constructs into the CLIPS data base
        * @return Zero if the file couldn’t be opened, -1 if the file
@@ -118,11 +215,106 @@ namespace CLIPS {
        */
       int load( const std::string& filename );
 
+      /** Counters of load_cached() */
+      struct LoadCacheStats {
+        LoadCacheStats();
+
+        unsigned long int hits; /**< Number of loads from a cached image */
+        unsigned long int misses; /**< Number of loads that parsed the sources */
+        double hash_time; /**< Summed time in seconds spent hashing sources */
+        double load_time; /**< Summed time in seconds spent loading images or sources */
+        double save_time; /**< Summed time in seconds spent writing images */
+      };
+
+      /**
+       * Loads constructs from source files through a cache of binary images.
+       * The contents of the files, in order, are hashed together with the
+       * clipsmm version and the pointer size. If cache_dir contains an image
+       * for the hash it is loaded with binary_load(), otherwise the
+       * environment is cleared, the files are loaded with load() and, if
+       * that succeeded, the image is written with binary_save(). Images are
+       * written to a temporary file and renamed, so several processes may
+       * share a cache directory.
+       *
+       * Like binary_load() this replaces all constructs of the
+       * environment, and constructs cannot be added afterwards without
+       * clearing it. User functions the constructs call must be added
+       * before.
+       * @return the result of load() as for a single file, 1 for a cache hit
+       */
+      int load_cached( const std::vector<std::string>& filenames, const std::string& cache_dir );
+
+      /** Returns the counters of load_cached() */
+      LoadCacheStats load_cache_stats() const;
+
+      /** Resets the counters of load_cached() */
+      void reset_load_cache_stats();
+
+      /**
+       * Loads a construct file and records which constructs came from it,
+       * for reload_changed(). The constructs are built one at a time, and
+       * each file starts in the MAIN module.
+       * @return 1 on success, -1 if constructs could not be built, 0 if the
+       * file could not be read
+       */
+      int load_tracked( const std::string& filename );
+
+      /**
+       * Reloads the files loaded with load_tracked() that changed since.
+       * Only the rules, facts, functions, globals and templates of those
+       * files are undefined and built again. Templates whose definition is
+       * unchanged stay defined, and so do their facts. If a construct cannot
+       * be undefined because constructs of other files use it, all tracked
+       * files are reloaded. The registry is emptied by clear().
+       * @return the number of files reloaded, -1 if files could not be read
+       * or constructs could not be undefined or built
+       */
+      int reload_changed();
+
+      /** The files loaded with load_tracked(), in the order they were loaded */
+      std::vector<std::string> tracked_files();
+
+      /**
+       * Loads constructs from a buffer holding either source text or a
+       * binary image as written by binary_save(). Source text is parsed
+       * in place. CLIPS reads binary images only from files, so they are
+       * passed through an anonymous in-memory file where memfd_create()
+       * is available.
+       * @return 1 on success, -1 if errors occurred while loading, 0 if
+       * a binary image could not be loaded
+       */
+      int load_from_memory( const char* data, std::size_t size );
+
+      /**
+       * Loads constructs from a file holding source text or a binary
+       * image. Source files are mapped into memory and parsed directly
+       * from the mapped pages. Binary images are read by CLIPS itself,
+       * as with binary_load().
+       * @return 1 on success, -1 if errors occurred while loading, 0 if
+       * the file could not be opened
+       */
+      int load_mapped( const std::string& filename );
+
       /**
        * Resets the CLIPS environment
        */
       void reset();
 
+      /**
+       * Resets the environment from a snapshot of the state reset() leaves.
+       * The first call, and the first call after constructs changed, does a
+       * full reset() and keeps the facts it asserted. Later calls retract
+       * only the facts asserted since and reassert the snapshot facts that
+       * were retracted; facts that were left alone are not matched again.
+       * Globals are reset as by reset(), and the rules are refreshed so the
+       * activations that fired are back on the agenda.
+       *
+       * Unlike after reset(), fact indices keep increasing and activations
+       * of the same salience may be in a different order. Environments with
+       * instances always get a full reset().
+       */
+      void fast_reset();
+
       /**
        * Saves a set of constructs to the specified file
        * @return false if an error occurred, true on success
@@ -258,6 +450,17 @@ namespace CLIPS {
       Fact::pointer assert_fact( Fact::pointer fact );
       Fact::pointer assert_fact_f( const char *format, ... );
 
+      /**
+       * Parses a fact pattern with ? placeholders once for repeated
+       * assertion with AssertPattern::assert_fact(), e.g.
+       * "(reading (sensor ?) (value ?))". An implied template is created
+       * for ordered facts if necessary. The pattern is invalidated when
+       * the environment is cleared.
+       * @return the prepared pattern, or a null pointer if it could not
+       * be parsed or refers to unknown slots
+       */
+      AssertPattern::pointer prepare_assert( const std::string& pattern );
+
       void clear_focus_stack();
 
       /** TODO Facts */
@@ -282,6 +485,35 @@ namespace CLIPS {
 
       DefaultFacts::pointer get_default_facts_list_head();
 
+      /**
+       * Gets the names of the constructs of a kind, from all modules or a
+       * specific one. The listings behind this and the get_*_names()
+       * methods are cached until constructs are defined or undefined, see
+       * constructs_changed(). After rules ran or CLIPS code was evaluated,
+       * a cached listing is checked against the constructs before it is
+       * used again, and only built anew if they changed.
+       */
+      std::vector<std::string> get_construct_names( ConstructType type,
+                                                    Module::pointer module = Module::pointer() );
+
+      /**
+       * Calls visitor with the module and construct name of every construct
+       * of a kind, from all modules or a specific one, without building a
+       * listing. The visitor must not define or undefine constructs.
+       */
+      void visit_constructs( ConstructType type, const sigc::slot<void, const char*, const char*>& visitor,
+                             Module::pointer module = Module::pointer() );
+
+      /**
+       * Drops cached construct listings and the wrappers shared by
+       * get_template(), get_rule(), get_global() and get_function(). The
+       * clipsmm methods that define or undefine constructs, run rules or
+       * evaluate CLIPS code take care of this, it is needed only after
+       * constructs were changed through the C API on cobj().
+       */
+      void constructs_changed();
+
+      /** Gets a template by name, the same wrapper while the template is defined */
       Template::pointer get_template( const std::string& template_name );
 
       /** Gets a list of template names from all modules */
@@ -295,6 +527,7 @@ namespace CLIPS {
 
       Template::pointer get_template_list_head();
 
+      /** Gets a rule by name, the same wrapper while the rule is defined */
       Rule::pointer get_rule( const std::string& rule_name );
 
       /** Gets a list of rule names from all modules */
@@ -379,6 +612,17 @@ namespace CLIPS {
        * priority, the higher in the queue. After each execution, the run
        * queue is checked and the next highest priority job is executed.
        *
+       * Jobs of equal priority that are waiting in the queue are coalesced
+       * into a single job: an unlimited runlimit subsumes any other runlimit,
+       * finite runlimits are summed. A burst of calls therefore results in
+       * a single engine pass and a single emission of signal_run().
+       *
+       * If the job has a higher priority than the job currently executed
+       * by the execution thread, the current job is preempted: execution
+       * halts after the rule that is currently firing, the new job runs,
+       * and the remainder of the preempted job is re-queued with its
+       * remaining runlimit.
+       *
        * If the normal run() method is executing, the execution thread will be
        * created, but will block until the previously executing call to run()
        * is completed. After run() completes, the execution thread will unblock
@@ -388,8 +632,11 @@ namespace CLIPS {
        * is just an early look at threading, but making it threadsafe will
        * not be too difficult. For now, to be safe, join the run thread before
        * changing anything in the environment.
+       *
+       * @return false if the execution thread could not be started, the
+       * job is dropped then
        */
-      void run_threaded( long int runlimit = -1, int priority = 0 );
+      bool run_threaded( long int runlimit = -1, int priority = 0 );
 
       /** Waits until the execution thread is finished */
       void join_run_thread();
@@ -397,6 +644,64 @@ namespace CLIPS {
       /** Signal emitted when the rules are executed. The signal emits the number of rules executed. */
       sigc::signal<void, long int> signal_run();
 
+      /** Latency statistics of threaded runs for one priority level */
+      struct RunStatistics {
+        RunStatistics();
+
+        unsigned long int jobs; /**< Number of completed jobs, merged requests count once */
+        unsigned long int preemptions; /**< Number of times a job was preempted */
+        unsigned long int coalesced; /**< Number of queued jobs merged into another job */
+
+        /**
+         * Waits and latencies are accounted per run_threaded() call, also for
+         * requests merged into another job. A request merged into a job that
+         * already started waits until the remainder of that job resumes. Mean
+         * values are therefore the totals divided by jobs + coalesced.
+         */
+        double total_wait; /**< Summed time in seconds from queueing to first execution */
+        double max_wait; /**< Maximum time in seconds from queueing to first execution */
+        double total_latency; /**< Summed time in seconds from queueing to completion */
+        double max_latency; /**< Maximum time in seconds from queueing to completion */
+      };
+
+      /** Result of a threaded run job, see poll_completions() */
+      struct RunCompletion {
+        int priority; /**< Priority of the job */
+        long int executed; /**< Number of rules fired by the job, including preempted parts */
+        unsigned long int coalesced; /**< Number of queued jobs merged into this job */
+        double latency; /**< Time in seconds from queueing the earliest merged job to completion */
+      };
+
+      /**
+       * Returns a file descriptor to integrate threaded runs into an event loop.
+       *
+       * The descriptor becomes readable whenever a job executed by
+       * run_threaded() completes. The results are then collected with
+       * poll_completions() on the event loop thread. The descriptor is
+       * created on the first call, completions are only recorded from then
+       * on. It is an eventfd where available, otherwise the read end of a
+       * pipe, and is owned by the environment.
+       * @return the file descriptor, or -1 if it could not be created
+       */
+      int notification_fd();
+
+      /**
+       * Collects the results of completed threaded run jobs without blocking
+       * and resets the notification file descriptor.
+       *
+       * If completions are not polled, at most 1024 are kept pending. Later
+       * ones are merged into the latest pending completion of the same
+       * priority and counted in its coalesced member.
+       * @return the jobs completed since the last call, in completion order
+       */
+      std::vector<RunCompletion> poll_completions();
+
+      /** Returns the statistics of threaded runs, keyed by job priority */
+      std::map<int, RunStatistics> run_statistics();
+
+      /** Resets the statistics of threaded runs */
+      void reset_run_statistics();
+
       /** Gets the salience evaluation mode */
       SalienceEvaluation get_salience_evaluation();
 
@@ -431,6 +736,17 @@ namespace CLIPS {
 
       Activation::pointer get_activation_list_head();
 
+      /**
+       * Captures the agenda of a module, or the agendas of all modules, in
+       * one pass without creating Activation wrappers. The activations are
+       * in agenda order, per module in module order.
+       */
+      std::vector<ActivationInfo> agenda_snapshot( Module::pointer module = Module::pointer() );
+
+      /** Like agenda_snapshot( module ), but reuses the storage of snapshot */
+      void agenda_snapshot( std::vector<ActivationInfo>& snapshot, Module::pointer module = Module::pointer() );
+
+      /** Gets a global by name, the same wrapper while the global is defined */
       Global::pointer get_global( const std::string& global_name );
 
       Global::pointer get_global_list_head();
@@ -446,6 +762,7 @@ namespace CLIPS {
 
       bool check_globals_changed();
 
+      /** Gets a deffunction by name, the same wrapper while the deffunction is defined */
       Function::pointer get_function( const std::string& function_name );
 
       Function::pointer get_function_list_head();
@@ -460,12 +777,44 @@ namespace CLIPS {
       std::vector<std::string> get_function_names( Module::pointer module );
 
       sigc::signal<void> signal_clear();
+
+      /**
+       * Signal emitted by CLIPS periodically while executing.
+       * The CLIPS periodic function is only installed while slots are
+       * connected. Connecting or disconnecting takes effect the next time
+       * the environment is entered, e.g. through run() or evaluate().
+       */
       sigc::signal<void> signal_periodic();
+
       sigc::signal<void> signal_reset();
+
+      /**
+       * Signal emitted after each rule firing.
+       * The CLIPS run function is only installed while slots are
+       * connected. Connecting or disconnecting takes effect the next time
+       * the environment is entered, e.g. through run() or evaluate().
+       */
       sigc::signal<void> signal_rule_firing();
       sigc::signal<void> signal_agenda_changed();
       sigc::signal<void> signal_globals_changed();
 
+      /**
+       * Adds a C++ function that can be called from CLIPS.
+       *
+       * Accepts any callable with a single call operator: function
+       * pointers, lambdas, std::function objects and other functors, of
+       * any arity. The return and argument types must be among those
+       * supported by get_return_code() and get_argument_code(). The
+       * callable is copied and invoked directly by a trampoline generated
+       * for its type, without a type erased wrapper in between.
+       *
+       * CLIPS checks the number of arguments when parsing calls to
+       * functions with up to nine arguments, for more arguments the count
+       * is checked on each call.
+       */
+      template <typename T_callable>
+      bool add_function( std::string name, const T_callable& callable );
+
       template < typename T_return >
       bool add_function( std::string name, const sigc::slot0<T_return>& slot);
 
@@ -492,1287 +841,503 @@ namespace CLIPS {
 
       bool remove_function( std::string name );
 
-    protected:
       /**
-       * Holds any dynamically created slots.
-       * Type any is used to hold different smart pointers, each of which hold different
-       * slots. When a slot is undefined, or at destruction when the map goes out of scope,
-       * the memory is reclaimed through the smart pointer.
+       * Enables or disables call profiling of functions added with
+       * add_function(). While disabled, the only cost per call is a
+       * check of a flag.
        */
-      std::map<std::string,any> m_slots;
-
-      sigc::signal<void> m_signal_clear;
-      sigc::signal<void> m_signal_periodic;
-      sigc::signal<void> m_signal_reset;
-      sigc::signal<void> m_signal_rule_firing;
-      sigc::signal<void> m_signal_agenda_changed;
-      sigc::signal<void> m_signal_globals_changed;
-
-      /** Encapsulates the concept of a CLIPS job. Has a priority for comparison and a runlimit */
-      typedef struct Job {
-        /** Constructor that takes a priority and a CLIPS runlimit */
-        Job( int p, long int rl ) : priority(p), runlimit(rl) { }
-
-        /** Comparison operator that compares the priority member */
-        bool operator<( const Job& other ) const { return priority < other.priority; }
-
-        /** The priority of this job. The higher the priority, the higher in the queue. */
-        int priority;
+      void enable_function_profiling( bool enable = true );
 
-        /**
-         * How many rules should fire.
-         * If runlimit is negative, rules will fire until the agenda is empty
-         */
-        long int runlimit;
-      } Job;
+      /** True if call profiling is enabled */
+      bool function_profiling_enabled() const;
 
-      Glib::Thread* m_run_thread; /**< A pointer to the currently running thread */
-      std::priority_queue<Job> m_run_queue; /**< A priority queue of jobs to run */
-      Glib::Mutex m_mutex_run_queue; /**< Mutex that protects access to the run queue */
-      Glib::Mutex m_mutex_run; /**< Mutex that protects against multiple executions */
-      Glib::Mutex m_mutex_threaded_run; /**< Mutex that locks when a threaded run is executing */
-      Glib::Mutex m_mutex_run_signal; /**< Mutex that protects against multiple signal emits */
-      sigc::signal<void, long int> m_signal_run; /**< Signal emitted when a job is run */
+      /** Returns the call statistics of all functions added with add_function() */
+      std::map<std::string, FunctionStats> function_stats() const;
 
-      /** Map from function name to restrictions.
+      /** Resets the call statistics of all functions */
+      void reset_function_stats();
 
-       * This is required for some versions of GCC (at least on
-       * 4.4.3), where the argstring in add_function() would point to
-       * the very same memory on consecutive calls for the same
-       * overloaded version, which would lead to the signature of a
-       * function in CLIPS being wrong if functions with the same
-       * number of arguments but different types would be added.
+    protected:
+      /**
+       * Holds the functions added with add_function(), which own the
+       * slots or other callables. When a function is undefined, or at
+       * destruction when the map goes out of scope, the memory is
+       * reclaimed through the smart pointer.
        */
-      std::map<std::string, char *> m_func_restr;
+      std::map<std::string, UserFunction::pointer> m_slots;
 
-      /** Protected method that does the actual work */
-      void threaded_run();
+      bool m_function_profiling; /**< True if newly added functions are profiled */
 
-      static std::map<void*, Environment*> m_environment_map;
+      /** Registers a user function with CLIPS and keeps it in m_slots */
+      bool define_function( const std::string& name, UserFunction::pointer function );
 
+      unsigned long int m_construct_generation; /**< Incremented whenever constructs may have changed */
+      unsigned long int m_code_generation; /**< Incremented after CLIPS code ran, it may have changed constructs */
 
-      static void clear_callback( void* env );
-      static void periodic_callback( void* env );
-      static void reset_callback( void* env );
-      static void rule_firing_callback( void* end );
+      /** Called after CLIPS code ran, cached listings and wrappers are checked before their next use */
+      void code_ran() { ++m_code_generation; }
 
-      static void* strcallback( void* theEnv );
+      int m_image_fd; /**< Anonymous file holding the image for clones, or -1 */
+      std::string m_image_path; /**< Binary image of the constructs for clone(), empty if none */
+      unsigned long int m_image_generation; /**< Construct generation the image was written at */
+      std::vector<void*> m_image_constructs; /**< Constructs the image was written from */
 
-      template < typename T_arg1 >
-      static void* strcallback( void* theEnv );
+      /** All constructs of all modules, compared to detect changes */
+      std::vector<void*> construct_list();
 
-      template < typename T_arg1, typename T_arg2 >
-      static void* strcallback( void* theEnv );
+      /** A cached listing of construct names */
+      struct ConstructListing {
+        ConstructListing(): code_generation(0), valid(false) { }
+        std::vector<std::string> names;
+        std::vector<const void*> signature; /**< See construct_signature() */
+        unsigned long int code_generation; /**< Code generation the listing was last checked at */
+        bool valid;
+      };
 
-      template < typename T_arg1, typename T_arg2, typename T_arg3 >
-      static void* strcallback( void* theEnv );
+      unsigned long int m_construct_names_generation; /**< Construct generation of m_construct_names */
+      std::map<std::pair<ConstructType, void*>, ConstructListing> m_construct_names;
 
-      template < typename T_arg1, typename T_arg2, typename T_arg3, typename T_arg4 >
-      static void* strcallback( void* theEnv );
-
-      template < typename T_arg1, typename T_arg2, typename T_arg3, typename T_arg4, typename T_arg5 >
-      static void* strcallback( void* theEnv );
-
-      template < typename T_arg1, typename T_arg2, typename T_arg3, typename T_arg4, typename T_arg5, typename T_arg6 >
-      static void* strcallback( void* theEnv );
-
-      template < typename T_arg1, typename T_arg2, typename T_arg3, typename T_arg4, typename T_arg5, typename T_arg6, typename T_arg7 >
-      static void* strcallback( void* theEnv );
-
-      template < typename T_return >
-      static T_return callback( void* theEnv );
-
-      template < typename T_return, typename T_arg1 >
-      static T_return callback( void* theEnv );
-
-      template < typename T_return, typename T_arg1, typename T_arg2 >
-      static T_return callback( void* theEnv );
-
-      template < typename T_return, typename T_arg1, typename T_arg2, typename T_arg3 >
-      static T_return callback( void* theEnv );
-
-      template < typename T_return, typename T_arg1, typename T_arg2, typename T_arg3, typename T_arg4 >
-      static T_return callback( void* theEnv );
-
-      template < typename T_return, typename T_arg1, typename T_arg2, typename T_arg3, typename T_arg4, typename T_arg5 >
-      static T_return callback( void* theEnv );
-
-      template < typename T_return, typename T_arg1, typename T_arg2, typename T_arg3, typename T_arg4, typename T_arg5, typename T_arg6 >
-      static T_return callback( void* theEnv );
+      /** Cached listing of construct names, module NULL for all modules */
+      const std::vector<std::string>& construct_names( ConstructType type, void* module );
 
-      template < typename T_return, typename T_arg1, typename T_arg2, typename T_arg3, typename T_arg4, typename T_arg5, typename T_arg6, typename T_arg7 >
-      static T_return callback( void* theEnv );
-
-      static void callback_multifield( void* theEnv, void *rv);
+      /** Successor of construct in the current module, the first one for NULL */
+      void* next_construct( ConstructType type, void* construct );
 
-      template <typename T_arg1>
-      static void callback_multifield( void* theEnv, void *rv );
-
-      template <typename T_arg1, typename T_arg2>
-      static void callback_multifield( void* theEnv, void *rv );
-
-      template <typename T_arg1, typename T_arg2, typename T_arg3>
-      static void callback_multifield( void* theEnv, void *rv );
-
-      template <typename T_arg1, typename T_arg2, typename T_arg3, typename T_arg4>
-      static void callback_multifield( void* theEnv, void *rv );
-
-      template <typename T_arg1, typename T_arg2, typename T_arg3, typename T_arg4,
-        typename T_arg5>
-      static void callback_multifield( void* theEnv, void *rv );
-
-      template <typename T_arg1, typename T_arg2, typename T_arg3, typename T_arg4,
-        typename T_arg5, typename T_arg6>
-      static void callback_multifield( void* theEnv, void *rv );
-
-      template <typename T_arg1, typename T_arg2, typename T_arg3, typename T_arg4,
-        typename T_arg5, typename T_arg6, typename T_arg7>
-      static void callback_multifield( void* theEnv, void *rv );
+      /** Name of a construct without module */
+      const char* construct_name( ConstructType type, void* construct );
 
+      /**
+       * Addresses of the constructs of a kind and of their names, module
+       * NULL for all modules. Cheap to take, compared to detect changes.
+       */
+      void construct_signature( ConstructType type, void* module, std::vector<const void*>& signature );
 
-      static void callback_unknown( void* theEnv, void *rv);
+      /** A shared construct wrapper and the code generation it was last checked at */
+      template <class T>
+      struct ConstructHandle {
+        ConstructHandle(): code_generation(0) { }
+        typename T::pointer wrapper;
+        unsigned long int code_generation;
+      };
 
-      template <typename T_arg1>
-      static void callback_unknown( void* theEnv, void *rv );
+      unsigned long int m_handles_generation; /**< Construct generation of the handle maps */
+      std::map<std::string, ConstructHandle<Template> > m_template_handles;
+      std::map<std::string, ConstructHandle<Rule> > m_rule_handles;
+      std::map<std::string, ConstructHandle<Global> > m_global_handles;
+      std::map<std::string, ConstructHandle<Function> > m_function_handles;
 
-      template <typename T_arg1, typename T_arg2>
-      static void callback_unknown( void* theEnv, void *rv );
+      /** Empties the handle maps if constructs changed since they were filled */
+      void check_handles();
 
-      template <typename T_arg1, typename T_arg2, typename T_arg3>
-      static void callback_unknown( void* theEnv, void *rv );
+      /** Finds a construct by name */
+      void* find_construct( ConstructType type, const std::string& name );
 
-      template <typename T_arg1, typename T_arg2, typename T_arg3, typename T_arg4>
-      static void callback_unknown( void* theEnv, void *rv );
-
-      template <typename T_arg1, typename T_arg2, typename T_arg3, typename T_arg4,
-        typename T_arg5>
-      static void callback_unknown( void* theEnv, void *rv );
+      /**
+       * Returns the shared wrapper of a construct. After CLIPS code ran, the
+       * construct is looked up again and the wrapper replaced only if the
+       * construct is a different one now.
+       */
+      template <class T>
+      typename T::pointer shared_handle( std::map<std::string, ConstructHandle<T> >& handles,
+                                         ConstructType type, const std::string& name );
+
+      /** Makes m_image_path an image of the current constructs */
+      bool prepare_image();
+
+      /** Copies facts and global values to an environment with the same constructs */
+      void copy_working_memory( Environment& target );
+
+      bool m_reset_snapshot; /**< True if the m_reset_ members hold a snapshot for fast_reset() */
+      unsigned long int m_reset_generation; /**< Construct generation the snapshot was taken at */
+      std::vector<void*> m_reset_constructs; /**< Constructs the snapshot was taken with */
+      std::vector<void*> m_reset_facts; /**< Facts after reset, kept with their fact count */
+      std::vector<void*> m_reset_globals; /**< Globals to reset, all modules */
+      std::vector<void*> m_reset_rules; /**< Rules to refresh, all modules */
+
+      /** Releases the facts of the fast_reset() snapshot */
+      void discard_reset_snapshot();
+
+      LoadCacheStats m_load_cache_stats;
+
+      /** A construct loaded with load_tracked() */
+      struct TrackedConstruct {
+        std::string kind; /**< defrule, deftemplate, ... */
+        std::string text; /**< The construct without comments and redundant whitespace */
+        std::vector<std::string> names; /**< Qualified names, several for defglobal */
+      };
+
+      /** A file loaded with load_tracked() */
+      struct TrackedFile {
+        long long mtime; /**< In nanoseconds, -1 if the contents have to be hashed on the next check */
+        long long size;
+        unsigned long long hash; /**< Of the contents */
+        std::vector<TrackedConstruct> constructs;
+      };
+
+      std::map<std::string, TrackedFile> m_tracked_files;
+      std::vector<std::string> m_tracked_order; /**< Files in the order of load_tracked() */
+
+      /** Builds the constructs of a file, except templates in kept, and records them */
+      bool build_tracked( TrackedFile& file, const std::vector<std::string>& constructs,
+                          const std::set<std::string>& kept );
 
-      template <typename T_arg1, typename T_arg2, typename T_arg3, typename T_arg4,
-        typename T_arg5, typename T_arg6>
-      static void callback_unknown( void* theEnv, void *rv );
+      /**
+       * Undefines the constructs of the given files, except templates in
+       * kept, rules first and templates last
+       * @return false if a construct could not be undefined
+       */
+      bool undefine_tracked( const std::map<std::string, std::vector<std::string> >& files,
+                             const std::set<std::string>& kept );
 
-      template <typename T_arg1, typename T_arg2, typename T_arg3, typename T_arg4,
-        typename T_arg5, typename T_arg6, typename T_arg7>
-      static void callback_unknown( void* theEnv, void *rv );
+      /** Loads a binary image from memory, see load_from_memory() */
+      bool binary_load_from_memory( const char* data, std::size_t size );
 
-      int ( *get_callback( const sigc::slot0<std::string>& slot ))( void* )
-        { return ( int ( * ) ( void* ) ) ( void* ( * ) ( void* ) ) strcallback; }
+      /** Cached lookups of functions for call() */
+      std::map<std::string, void*> m_call_functions;
 
-      template < typename T_arg1 >
-      int ( *get_callback( const sigc::slot1<std::string,T_arg1>& slot ))( void* )
-        { return ( int ( * ) ( void* ) ) ( void* ( * ) ( void* ) ) strcallback<T_arg1>; }
+      /** Calls a function with num_arguments arguments */
+      Values call( const std::string& function_name, const Value* arguments, std::size_t num_arguments );
 
-      template < typename T_arg1, typename T_arg2 >
-      int ( *get_callback( const sigc::slot2<std::string,T_arg1,T_arg2>& slot ))( void* )
-        { return ( int ( * ) ( void* ) ) ( void* ( * ) ( void* ) ) strcallback<T_arg1,T_arg2>; }
+      /** Parses an expression, returns the installed expression or NULL */
+      void* parse_expression( const std::string& expression );
 
-      template < typename T_arg1, typename T_arg2, typename T_arg3 >
-      int ( *get_callback( const sigc::slot3<std::string,T_arg1,T_arg2,T_arg3>& slot ))( void* )
-        { return (int(*)(void*)) (void* (*)(void*)) strcallback<T_arg1,T_arg2,T_arg3>; }
+      /** Prepares the engine for evaluating expressions from the top level */
+      void begin_evaluation();
 
-      template < typename T_arg1, typename T_arg2, typename T_arg3, typename T_arg4 >
-      int ( *get_callback( const sigc::slot4<std::string,T_arg1,T_arg2,T_arg3,T_arg4>& slot ))( void* )
-        { return (int(*)(void*)) (void* (*)(void*)) strcallback<T_arg1,T_arg2,T_arg3,T_arg4>; }
+      friend class Expression;
+      std::set<Expression*> m_expressions; /**< Prepared expressions that are still valid */
 
-      template < typename T_arg1, typename T_arg2, typename T_arg3, typename T_arg4, typename T_arg5 >
-      int ( *get_callback( const sigc::slot5<std::string,T_arg1,T_arg2,T_arg3,T_arg4,T_arg5>& slot ))( void* )
-        { return (int(*)(void*)) (void* (*)(void*)) strcallback<T_arg1,T_arg2,T_arg3,T_arg4,T_arg5>; }
+      friend class AssertPattern;
+      std::set<AssertPattern*> m_assert_patterns; /**< Prepared assert patterns that are still valid */
 
-      template < typename T_arg1, typename T_arg2, typename T_arg3, typename T_arg4, typename T_arg5, typename T_arg6 >
-      int ( *get_callback( const sigc::slot6<std::string,T_arg1,T_arg2,T_arg3,T_arg4,T_arg5,T_arg6>& slot ))( void* )
-        { return (int(*)(void*)) (void* (*)(void*)) strcallback<T_arg1,T_arg2,T_arg3,T_arg4,T_arg5,T_arg6>; }
+      /** Invalidates all prepared expressions and patterns, called before constructs are cleared */
+      void invalidate_prepared();
 
-      template < typename T_arg1, typename T_arg2, typename T_arg3, typename T_arg4, typename T_arg5, typename T_arg6, typename T_arg7 >
-      int ( *get_callback( const sigc::slot7<std::string,T_arg1,T_arg2,T_arg3,T_arg4,T_arg5,T_arg6,T_arg7>& slot ))( void* )
-        { return (int(*)(void*)) (void* (*)(void*)) strcallback<T_arg1,T_arg2,T_arg3,T_arg4,T_arg5,T_arg6,T_arg7>; }
+      sigc::signal<void> m_signal_clear;
+      sigc::signal<void> m_signal_periodic;
+      sigc::signal<void> m_signal_reset;
+      sigc::signal<void> m_signal_rule_firing;
+      sigc::signal<void> m_signal_agenda_changed;
+      sigc::signal<void> m_signal_globals_changed;
 
-      int ( *get_callback( const sigc::slot0<Values>& slot ))( void* )
-      { return  (int (*) (void*)) (void (*) (void*, void*)) callback_multifield; }
+      /** Encapsulates the concept of a CLIPS job. Has a priority for comparison and a runlimit */
+      /**
+       * Queue times of the requests merged into a job, kept as aggregates
+       * so that a burst of requests takes constant space.
+       */
+      struct QueueTimes {
+        QueueTimes() : count(0), sum(0.0) { }
+
+        /** Adds the queue time of one request */
+        void add( std::chrono::steady_clock::time_point t ) {
+          if ( count == 0 || t < earliest ) earliest = t;
+          sum += std::chrono::duration<double>( t.time_since_epoch() ).count();
+          ++count;
+        }
+
+        /** Adds the queue times of other */
+        void merge( const QueueTimes& other ) {
+          if ( other.count == 0 ) return;
+          if ( count == 0 || other.earliest < earliest ) earliest = other.earliest;
+          sum += other.sum;
+          count += other.count;
+        }
+
+        /** Adds the times the requests were queued at now to total, and the longest to max */
+        void account( std::chrono::steady_clock::time_point now, double& total, double& max ) const {
+          if ( count == 0 ) return;
+          total += count * std::chrono::duration<double>( now.time_since_epoch() ).count() - sum;
+          double longest = std::chrono::duration<double>( now - earliest ).count();
+          if ( longest > max ) max = longest;
+        }
+
+        unsigned long int count; /**< Number of requests */
+        double sum; /**< Summed queue times, in seconds of the steady clock */
+        std::chrono::steady_clock::time_point earliest; /**< Queue time of the first request */
+      };
 
-      template <typename T_arg1>
-      int ( *get_callback( const sigc::slot1<Values,T_arg1>& slot ))( void* )
-      { return (int (*) (void*)) ( void ( * ) ( void*, void* ) ) callback_multifield<T_arg1>; }
+      typedef struct Job {
+        /** Constructor that takes a priority and a CLIPS runlimit */
+        Job( int p, long int rl ) :
+          priority(p), runlimit(rl), executed(0), coalesced(0) {
+          queued.add( std::chrono::steady_clock::now() );
+          waiting = queued;
+        }
 
-      template <typename T_arg1, typename T_arg2>
-      int ( *get_callback( const sigc::slot2<Values,T_arg1,T_arg2>& slot ))( void* )
-      { return (int (*) (void*)) ( void ( * ) ( void*, void* ) ) callback_multifield<T_arg1,T_arg2>; }
+        /** Comparison operator that compares the priority member */
+        bool operator<( const Job& other ) const { return priority < other.priority; }
 
-      template <typename T_arg1, typename T_arg2, typename T_arg3>
-        int ( *get_callback( const sigc::slot3<Values,T_arg1,T_arg2,T_arg3>& slot ))( void* )
-      { return (int (*) (void*)) ( void ( * ) ( void*, void* ) ) callback_multifield<T_arg1,T_arg2,T_arg3>; }
+        /**
+         * Merges another job of the same priority into this one.
+         * An unlimited runlimit subsumes any other, finite ones are summed.
+         * The queue times of all merged requests are aggregated, so that
+         * waits and latencies are accounted per request.
+         */
+        void coalesce( const Job& other ) {
+          runlimit = ( runlimit < 0 || other.runlimit < 0 ) ? -1 : runlimit + other.runlimit;
+          executed += other.executed;
+          coalesced += other.coalesced + 1;
+          queued.merge( other.queued );
+          waiting.merge( other.waiting );
+        }
 
-      template <typename T_arg1, typename T_arg2, typename T_arg3, typename T_arg4>
-        int ( *get_callback( const sigc::slot4<Values,T_arg1,T_arg2,T_arg3,T_arg4>& slot ))( void* )
-      { return (int (*) (void*)) ( void ( * ) ( void*, void* ) ) callback_multifield<T_arg1,T_arg2,T_arg3,T_arg4>; }
+        /** The priority of this job. The higher the priority, the higher in the queue. */
+        int priority;
 
-      template <typename T_arg1, typename T_arg2, typename T_arg3, typename T_arg4, typename T_arg5>
-        int ( *get_callback( const sigc::slot5<Values,T_arg1,T_arg2,T_arg3,T_arg4,T_arg5>& slot ))( void* )
-      { return (int (*) (void*)) ( void ( * ) ( void*, void* ) ) callback_multifield<T_arg1,T_arg2,T_arg3,T_arg4,T_arg5>; }
+        /**
+         * How many rules should fire.
+         * If runlimit is negative, rules will fire until the agenda is empty
+         */
+        long int runlimit;
 
-      template <typename T_arg1, typename T_arg2, typename T_arg3, typename T_arg4, typename T_arg5, typename T_arg6>
-        int ( *get_callback( const sigc::slot6<Values,T_arg1,T_arg2,T_arg3,T_arg4,T_arg5,T_arg6>& slot ))( void* )
-      { return (int (*) (void*)) ( void ( * ) ( void*, void* ) ) callback_multifield<T_arg1,T_arg2,T_arg3,T_arg4,T_arg5,T_arg6>; }
+        /** Number of rules fired by preempted parts of this job */
+        long int executed;
 
-      template <typename T_arg1, typename T_arg2, typename T_arg3, typename T_arg4, typename T_arg5, typename T_arg6, typename T_arg7>
-        int ( *get_callback( const sigc::slot7<Values,T_arg1,T_arg2,T_arg3,T_arg4,T_arg5,T_arg6,T_arg7>& slot ))( void* )
-      { return (int (*) (void*)) ( void ( * ) ( void*, void* ) ) callback_multifield<T_arg1,T_arg2,T_arg3,T_arg4,T_arg5,T_arg6,T_arg7>; }
+        /** Number of jobs merged into this one */
+        unsigned long int coalesced;
 
+        /** Queue times of all merged requests, kept when a preempted job is re-queued */
+        QueueTimes queued;
 
-      int ( *get_callback( const sigc::slot0<Value>& slot ))( void* )
-      { return  (int (*) (void*)) (void (*) (void*, void*)) callback_unknown; }
+        /** Queue times of the merged requests that have not been executed yet */
+        QueueTimes waiting;
+      } Job;
 
-      template <typename T_arg1>
-      int ( *get_callback( const sigc::slot1<Value,T_arg1>& slot ))( void* )
-      { return (int (*) (void*)) ( void ( * ) ( void*, void* ) ) callback_unknown<T_arg1>; }
+      Glib::Thread* m_run_thread; /**< A pointer to the currently running thread */
+      /** Jobs to run, at most one per priority, highest priority first */
+      typedef std::map<int, Job, std::greater<int> > RunQueue;
+      RunQueue m_run_queue; /**< The queue of jobs to run */
 
-      template <typename T_arg1, typename T_arg2>
-      int ( *get_callback( const sigc::slot2<Value,T_arg1,T_arg2>& slot ))( void* )
-      { return (int (*) (void*)) ( void ( * ) ( void*, void* ) ) callback_unknown<T_arg1,T_arg2>; }
+      /** Adds a job to the run queue, coalescing it with a queued job of the same priority */
+      void enqueue_job( const Job& job );
+      Glib::Mutex m_mutex_run_queue; /**< Mutex that protects access to the run queue */
+      Glib::Mutex m_mutex_run; /**< Mutex that protects against multiple executions */
+      Glib::Mutex m_mutex_threaded_run; /**< Mutex that locks when a threaded run is executing */
+      Glib::Mutex m_mutex_run_signal; /**< Mutex that protects against multiple signal emits */
+      sigc::signal<void, long int> m_signal_run; /**< Signal emitted when a job is run */
+      bool m_job_active; /**< True while the execution thread executes a job, protected by the run queue mutex */
+      int m_active_priority; /**< Priority of the job currently executed, protected by the run queue mutex */
+      std::atomic<bool> m_preempt_requested; /**< Set to halt the current threaded job at the next rule boundary */
+      std::map<int, RunStatistics> m_run_statistics; /**< Run statistics per priority, protected by the run queue mutex */
+      int m_notify_fd[2]; /**< Read and write end of the notification descriptor, identical for an eventfd */
+      std::vector<RunCompletion> m_completions; /**< Completions not yet polled, protected by the run queue mutex */
 
-      template <typename T_arg1, typename T_arg2, typename T_arg3>
-        int ( *get_callback( const sigc::slot3<Value,T_arg1,T_arg2,T_arg3>& slot ))( void* )
-      { return (int (*) (void*)) ( void ( * ) ( void*, void* ) ) callback_unknown<T_arg1,T_arg2,T_arg3>; }
+      /** Records a completion, merging it into a pending one once too many are pending */
+      void push_completion( const RunCompletion& completion );
 
-      template <typename T_arg1, typename T_arg2, typename T_arg3, typename T_arg4>
-        int ( *get_callback( const sigc::slot4<Value,T_arg1,T_arg2,T_arg3,T_arg4>& slot ))( void* )
-      { return (int (*) (void*)) ( void ( * ) ( void*, void* ) ) callback_unknown<T_arg1,T_arg2,T_arg3,T_arg4>; }
+      /** Protected method that does the actual work */
+      void threaded_run();
 
-      template <typename T_arg1, typename T_arg2, typename T_arg3, typename T_arg4, typename T_arg5>
-        int ( *get_callback( const sigc::slot5<Value,T_arg1,T_arg2,T_arg3,T_arg4,T_arg5>& slot ))( void* )
-      { return (int (*) (void*)) ( void ( * ) ( void*, void* ) ) callback_unknown<T_arg1,T_arg2,T_arg3,T_arg4,T_arg5>; }
+      bool m_periodic_callback_installed; /**< True if the periodic callback is registered with CLIPS */
+      bool m_rule_firing_callback_installed; /**< True if the rule firing callback is registered with CLIPS */
 
-      template <typename T_arg1, typename T_arg2, typename T_arg3, typename T_arg4, typename T_arg5, typename T_arg6>
-        int ( *get_callback( const sigc::slot6<Value,T_arg1,T_arg2,T_arg3,T_arg4,T_arg5,T_arg6>& slot ))( void* )
-      { return (int (*) (void*)) ( void ( * ) ( void*, void* ) ) callback_unknown<T_arg1,T_arg2,T_arg3,T_arg4,T_arg5,T_arg6>; }
+      /**
+       * Installs or removes the periodic and rule firing callbacks depending
+       * on whether any slots are connected to the respective signals.
+       */
+      void update_callbacks();
 
-      template <typename T_arg1, typename T_arg2, typename T_arg3, typename T_arg4, typename T_arg5, typename T_arg6, typename T_arg7>
-        int ( *get_callback( const sigc::slot7<Value,T_arg1,T_arg2,T_arg3,T_arg4,T_arg5,T_arg6,T_arg7>& slot ))( void* )
-      { return (int (*) (void*)) ( void ( * ) ( void*, void* ) ) callback_unknown<T_arg1,T_arg2,T_arg3,T_arg4,T_arg5,T_arg6,T_arg7>; }
+      static std::map<void*, Environment*> m_environment_map;
 
 
-      template < typename T_return >
-      int ( *get_callback( const sigc::slot0<T_return>& slot ))( void* )
-        { return (int (*) (void*)) ( T_return ( * ) ( void* ) ) callback<T_return>; }
+      static void clear_callback( void* env );
+      static void periodic_callback( void* env );
+      static void reset_callback( void* env );
+      static void rule_firing_callback( void* end );
+      static void preempt_callback( void* env );
 
-      template < typename T_return, typename T_arg1 >
-      int ( *get_callback( const sigc::slot1<T_return,T_arg1>& slot ))( void* )
-        { return ( int ( * ) ( void* ) ) ( T_return ( * ) ( void* ) ) callback<T_return,T_arg1>; }
+      /** Signature of the function pointers passed to CLIPS */
+      typedef UserFunction::Callback FunctionCallback;
 
-      template < typename T_return, typename T_arg1, typename T_arg2 >
-      int ( *get_callback( const sigc::slot2<T_return,T_arg1,T_arg2>& slot ))( void* )
-        { return ( int ( * ) ( void* ) ) ( T_return ( * ) ( void* ) ) callback<T_return,T_arg1,T_arg2>; }
+      /** Tag type to select a callback trampoline by return type */
+      template <typename T_return>
+      struct ReturnTag { };
 
-      template < typename T_return, typename T_arg1, typename T_arg2, typename T_arg3 >
-      int ( *get_callback( const sigc::slot3<T_return,T_arg1,T_arg2,T_arg3>& slot ))( void* )
-        { return (int(*)(void*)) (T_return(*)(void*)) callback<T_return,T_arg1,T_arg2,T_arg3>; }
+      template <typename T_callable, std::size_t... I>
+      static typename FunctionTraits<T_callable>::return_type invoke_function( void* theEnv, T_callable& callable, IndexSequence<I...> );
 
-      template < typename T_return, typename T_arg1, typename T_arg2, typename T_arg3, typename T_arg4 >
-      int ( *get_callback( const sigc::slot4<T_return,T_arg1,T_arg2,T_arg3,T_arg4>& slot ))( void* )
-        { return (int(*)(void*)) (T_return(*)(void*)) callback<T_return,T_arg1,T_arg2,T_arg3,T_arg4>; }
+      template <typename T_callable>
+      static typename FunctionTraits<T_callable>::return_type call_function( void* theEnv );
 
-      template < typename T_return, typename T_arg1, typename T_arg2, typename T_arg3, typename T_arg4, typename T_arg5 >
-      int ( *get_callback( const sigc::slot5<T_return,T_arg1,T_arg2,T_arg3,T_arg4,T_arg5>& slot ))( void* )
-        { return (int(*)(void*)) (T_return(*)(void*)) callback<T_return,T_arg1,T_arg2,T_arg3,T_arg4,T_arg5>; }
+      template <typename T_callable>
+      static typename FunctionTraits<T_callable>::return_type callback( void* theEnv );
 
-      template < typename T_return, typename T_arg1, typename T_arg2, typename T_arg3, typename T_arg4, typename T_arg5, typename T_arg6 >
-      int ( *get_callback( const sigc::slot6<T_return,T_arg1,T_arg2,T_arg3,T_arg4,T_arg5,T_arg6>& slot ))( void* )
-        { return (int(*)(void*)) (T_return(*)(void*)) callback<T_return,T_arg1,T_arg2,T_arg3,T_arg4,T_arg5,T_arg6>; }
+      template <typename T_callable>
+      static void* strcallback( void* theEnv );
 
-      template < typename T_return, typename T_arg1, typename T_arg2, typename T_arg3, typename T_arg4, typename T_arg5, typename T_arg6, typename T_arg7 >
-      int ( *get_callback( const sigc::slot7<T_return,T_arg1,T_arg2,T_arg3,T_arg4,T_arg5,T_arg6,T_arg7>& slot ))( void* )
-        { return (int(*)(void*)) (T_return(*)(void*)) callback<T_return,T_arg1,T_arg2,T_arg3,T_arg4,T_arg5,T_arg6,T_arg7>; }
+      template <typename T_callable>
+      static void callback_multifield( void* theEnv, void *rv );
 
-      char * get_function_restriction(std::string &name);
+      template <typename T_callable>
+      static void callback_unknown( void* theEnv, void *rv );
 
-      template <typename T_arg1>
-        char * get_function_restriction(std::string &name);
+      template <typename T_callable, typename T_return>
+      static FunctionCallback get_callback( ReturnTag<T_return> )
+        { return ( FunctionCallback ) ( T_return ( * ) ( void* ) ) callback<T_callable>; }
 
-      template <typename T_arg1, typename T_arg2>
-        char * get_function_restriction(std::string &name);
+      template <typename T_callable>
+      static FunctionCallback get_callback( ReturnTag<std::string> )
+        { return ( FunctionCallback ) ( void* ( * ) ( void* ) ) strcallback<T_callable>; }
 
-      template <typename T_arg1, typename T_arg2, typename T_arg3>
-        char * get_function_restriction(std::string &name);
+      template <typename T_callable>
+      static FunctionCallback get_callback( ReturnTag<Values> )
+        { return ( FunctionCallback ) ( void ( * ) ( void*, void* ) ) callback_multifield<T_callable>; }
 
-      template <typename T_arg1, typename T_arg2, typename T_arg3, typename T_arg4>
-        char * get_function_restriction(std::string &name);
+      template <typename T_callable>
+      static FunctionCallback get_callback( ReturnTag<Value> )
+        { return ( FunctionCallback ) ( void ( * ) ( void*, void* ) ) callback_unknown<T_callable>; }
 
-      template <typename T_arg1, typename T_arg2, typename T_arg3, typename T_arg4, typename T_arg5>
-        char * get_function_restriction(std::string &name);
+      template <typename T_callable>
+      static FunctionCallback get_callback( ReturnTag<Fact::pointer> )
+        { return ( FunctionCallback ) ( void ( * ) ( void*, void* ) ) callback_unknown<T_callable>; }
 
-      template <typename T_arg1, typename T_arg2, typename T_arg3, typename T_arg4, typename T_arg5, typename T_arg6>
-        char * get_function_restriction(std::string &name);
+      template <typename T_callable>
+      static FunctionCallback get_callback( ReturnTag<FactRef> )
+        { return ( FunctionCallback ) ( void ( * ) ( void*, void* ) ) callback_unknown<T_callable>; }
 
-      template <typename T_arg1, typename T_arg2, typename T_arg3, typename T_arg4, typename T_arg5, typename T_arg6, typename T_arg7>
-        char * get_function_restriction(std::string &name);
+      /** Registers a callable of (decayed) type T_callable with CLIPS */
+      template <typename T_callable>
+      bool add_callable( const std::string& name, const T_callable& callable );
 
 
       static int get_arg_count( void* env );
       static void* get_function_context( void* env );
       static void  set_return_values( void *env, void *rv, const Values &v);
       static void  set_return_value( void *env, void *rv, const Value &v);
+      /** Returns a fact address, or the symbol FALSE for a null fact */
+      static void  set_return_value( void *env, void *rv, const Fact::pointer &f);
+      static void  set_return_value( void *env, void *rv, const FactRef &f);
+
+      friend void get_argument( void* env, int argposition, Fact::pointer& value );
       static void* add_symbol( void *env, const char* s );
 
 
   };
 
 
-  inline char *
-  Environment::get_function_restriction(std::string &name) {
-    if (m_func_restr.find(name) != m_func_restr.end())  free(m_func_restr[name]);
-    char *restr = (char *)malloc(4); m_func_restr[name] = restr;
-    snprintf(restr, 4, "00u");
-    return restr;
-  }
-
-  template <typename T_arg1>
-  inline char *
-  Environment::get_function_restriction(std::string &name) {
-    if (m_func_restr.find(name) != m_func_restr.end())  free(m_func_restr[name]);
-    char *restr = (char *)malloc(5); m_func_restr[name] = restr;
-    snprintf(restr, 5, "11u%c", get_argument_code<T_arg1>());
-    return restr;
-  }
-
-  template <typename T_arg1, typename T_arg2>
-  inline char *
-  Environment::get_function_restriction(std::string &name) {
-    if (m_func_restr.find(name) != m_func_restr.end())  free(m_func_restr[name]);
-    char *restr = (char *)malloc(6); m_func_restr[name] = restr;
-    snprintf(restr, 6, "22u%c%c", get_argument_code<T_arg1>(), get_argument_code<T_arg2>());
-    return restr;
-  }
-
-  template <typename T_arg1, typename T_arg2, typename T_arg3>
-  inline char *
-  Environment::get_function_restriction(std::string &name) {
-    if (m_func_restr.find(name) != m_func_restr.end())  free(m_func_restr[name]);
-    char *restr = (char *)malloc(7); m_func_restr[name] = restr;
-    snprintf(restr, 7, "33u%c%c%c", get_argument_code<T_arg1>(), get_argument_code<T_arg2>(),
-             get_argument_code<T_arg3>());
-    return restr;
-  }
-
-  template <typename T_arg1, typename T_arg2, typename T_arg3, typename T_arg4>
-  inline char *
-  Environment::get_function_restriction(std::string &name) {
-    if (m_func_restr.find(name) != m_func_restr.end())  free(m_func_restr[name]);
-    char *restr = (char *)malloc(8); m_func_restr[name] = restr;
-    snprintf(restr, 8, "44u%c%c%c%c", get_argument_code<T_arg1>(), get_argument_code<T_arg2>(),
-             get_argument_code<T_arg3>(), get_argument_code<T_arg4>());
-    return restr;
-  }
-
-  template <typename T_arg1, typename T_arg2, typename T_arg3, typename T_arg4,
-    typename T_arg5>
-  inline char *
-  Environment::get_function_restriction(std::string &name) {
-    if (m_func_restr.find(name) != m_func_restr.end())  free(m_func_restr[name]);
-    char *restr = (char *)malloc(9); m_func_restr[name] = restr;
-    snprintf(restr, 9, "55u%c%c%c%c%c", get_argument_code<T_arg1>(), get_argument_code<T_arg2>(),
-             get_argument_code<T_arg3>(), get_argument_code<T_arg4>(), get_argument_code<T_arg5>());
-    return restr;
-  }
-
-  template <typename T_arg1, typename T_arg2, typename T_arg3, typename T_arg4,
-    typename T_arg5, typename T_arg6>
-  inline char *
-  Environment::get_function_restriction(std::string &name) {
-    if (m_func_restr.find(name) != m_func_restr.end())  free(m_func_restr[name]);
-    char *restr = (char *)malloc(10); m_func_restr[name] = restr;
-    snprintf(restr, 10, "66u%c%c%c%c%c%c", get_argument_code<T_arg1>(), get_argument_code<T_arg2>(),
-             get_argument_code<T_arg3>(), get_argument_code<T_arg4>(), get_argument_code<T_arg5>(),
-             get_argument_code<T_arg6>());
-    return restr;
-  }
-
-  template <typename T_arg1, typename T_arg2, typename T_arg3, typename T_arg4,
-    typename T_arg5, typename T_arg6, typename T_arg7>
-  inline char *
-  Environment::get_function_restriction(std::string &name) {
-    if (m_func_restr.find(name) != m_func_restr.end())  free(m_func_restr[name]);
-    char *restr = (char *)malloc(11); m_func_restr[name] = restr;
-    snprintf(restr, 11, "77u%c%c%c%c%c%c%c", get_argument_code<T_arg1>(), get_argument_code<T_arg2>(),
-             get_argument_code<T_arg3>(), get_argument_code<T_arg4>(), get_argument_code<T_arg5>(),
-             get_argument_code<T_arg6>(), get_argument_code<T_arg7>());
-    return restr;
-  }
-
-
-  template < typename T_return>
+  template <typename T_callable, std::size_t... I>
   inline
-  T_return Environment::callback( void* theEnv ) {
-    sigc::slot0<T_return>* cb;
-    void * cbptr = get_function_context( theEnv );
-    if ( cbptr ) {
-      if ( get_arg_count( theEnv ) != 0 )
-        throw std::logic_error( "clipsmm: wrong # args on slot callback; expected 0" );
-      cb = static_cast<sigc::slot0<T_return>*>( cbptr );
-      return ( *cb ) ();
-    }
-    throw;
+  typename FunctionTraits<T_callable>::return_type Environment::invoke_function( void* theEnv, T_callable& callable, IndexSequence<I...> ) {
+    if ( sizeof...( I ) > 9 && get_arg_count( theEnv ) != (int)sizeof...( I ) )
+      throw std::logic_error( "clipsmm: wrong # args on function callback" );
+    typename FunctionTraits<T_callable>::argument_tuple args;
+    int expand[] = { 0, ( get_argument( theEnv, I + 1, std::get<I>( args ) ), 0 )... };
+    (void) expand;
+    return callable( std::get<I>( args )... );
   }
 
-  template < typename T_return, typename T_arg1 >
+  template <typename T_callable>
   inline
-  T_return Environment::callback( void* theEnv ) {
-    sigc::slot1<T_return,T_arg1>* cb;
-    void * cbptr = get_function_context( theEnv );
-    T_arg1 arg1;
-    if ( cbptr ) {
-      if ( get_arg_count( theEnv ) != 1 )
-        throw std::logic_error( "clipsmm: wrong # args on slot callback; expected 1" );
-      get_argument( theEnv, 1, arg1 );
-      cb = static_cast<sigc::slot1<T_return,T_arg1>*>( cbptr );
-      return ( *cb ) ( arg1 );
+  typename FunctionTraits<T_callable>::return_type Environment::call_function( void* theEnv ) {
+    UserFunctionImpl<T_callable>* function = static_cast<UserFunctionImpl<T_callable>*>( get_function_context( theEnv ) );
+    if ( function->profiling() ) {
+      UserFunction::CallTimer timer( *function );
+      return invoke_function( theEnv, function->callable, MakeIndexSequence<FunctionTraits<T_callable>::arity>() );
     }
-    throw;
+    return invoke_function( theEnv, function->callable, MakeIndexSequence<FunctionTraits<T_callable>::arity>() );
   }
 
-  template < typename T_return, typename T_arg1, typename T_arg2 >
-  inline
-  T_return Environment::callback( void* theEnv ) {
-    sigc::slot2<T_return, T_arg1, T_arg2>* cb;
-    void * cbptr = get_function_context( theEnv );
-    T_arg1 arg1;
-    T_arg2 arg2;
-    if ( cbptr ) {
-      if ( get_arg_count( theEnv ) != 2 )
-        throw std::logic_error( "clipsmm: wrong # args on slot callback; expected 2" );
-      get_argument( theEnv, 1, arg1 );
-      get_argument( theEnv, 2, arg2 );
-      cb = static_cast<sigc::slot2<T_return, T_arg1, T_arg2>*>( cbptr );
-      return ( *cb ) ( arg1, arg2 );
-    }
-    throw;
-  }
-
-  template < typename T_return, typename T_arg1, typename T_arg2, typename T_arg3 >
+  template <typename T_callable>
   inline
-  T_return Environment::callback( void* theEnv ) {
-    sigc::slot3<T_return,T_arg1,T_arg2,T_arg3>* cb;
-    void * cbptr = get_function_context( theEnv );
-    T_arg1 arg1;
-    T_arg2 arg2;
-    T_arg3 arg3;
-    if ( cbptr ) {
-      if ( get_arg_count( theEnv ) != 3 )
-        throw std::logic_error( "clipsmm: wrong # args on slot callback; expected 3" );
-      get_argument( theEnv, 1, arg1 );
-      get_argument( theEnv, 2, arg2 );
-      get_argument( theEnv, 3, arg3 );
-      cb = static_cast<sigc::slot3<T_return, T_arg1, T_arg2,T_arg3>*>( cbptr );
-      return ( *cb ) ( arg1, arg2, arg3 );
-    }
-    throw;
-  }
-
-  template < typename T_return, typename T_arg1, typename T_arg2, typename T_arg3, typename T_arg4 >
-  inline
-  T_return Environment::callback( void* theEnv ) {
-    sigc::slot4<T_return,T_arg1,T_arg2,T_arg3,T_arg4>* cb;
-    void * cbptr = get_function_context( theEnv );
-    T_arg1 arg1;
-    T_arg2 arg2;
-    T_arg3 arg3;
-    T_arg4 arg4;
-    if ( cbptr ) {
-      if ( get_arg_count( theEnv ) != 4 )
-        throw std::logic_error( "clipsmm: wrong # args on slot callback; expected 4" );
-      get_argument( theEnv, 1, arg1 );
-      get_argument( theEnv, 2, arg2 );
-      get_argument( theEnv, 3, arg3 );
-      get_argument( theEnv, 4, arg4 );
-      cb = static_cast<sigc::slot4<T_return, T_arg1, T_arg2,T_arg3,T_arg4>*>( cbptr );
-      return ( *cb ) ( arg1, arg2, arg3, arg4 );
-    }
-    throw;
-  }
-
-  template < typename T_return, typename T_arg1, typename T_arg2, typename T_arg3, typename T_arg4, typename T_arg5 >
-  inline
-  T_return Environment::callback( void* theEnv ) {
-    sigc::slot5<T_return,T_arg1,T_arg2,T_arg3,T_arg4,T_arg5>* cb;
-    void * cbptr = get_function_context( theEnv );
-    T_arg1 arg1;
-    T_arg2 arg2;
-    T_arg3 arg3;
-    T_arg4 arg4;
-    T_arg5 arg5;
-    if ( cbptr ) {
-      if ( get_arg_count( theEnv ) != 5 )
-        throw std::logic_error( "clipsmm: wrong # args on slot callback; expected 5" );
-      get_argument( theEnv, 1, arg1 );
-      get_argument( theEnv, 2, arg2 );
-      get_argument( theEnv, 3, arg3 );
-      get_argument( theEnv, 4, arg4 );
-      get_argument( theEnv, 5, arg5 );
-      cb = static_cast<sigc::slot5<T_return, T_arg1, T_arg2,T_arg3,T_arg4,T_arg5>*>( cbptr );
-      return ( *cb ) ( arg1, arg2, arg3, arg4, arg5 );
-    }
-    throw;
-  }
-
- template < typename T_return, typename T_arg1, typename T_arg2, typename T_arg3, typename T_arg4, typename T_arg5, typename T_arg6 >
- inline
- T_return Environment::callback( void* theEnv ) {
-   sigc::slot6<T_return,T_arg1,T_arg2,T_arg3,T_arg4,T_arg5,T_arg6>* cb;
-   void * cbptr = get_function_context( theEnv );
-   T_arg1 arg1;
-   T_arg2 arg2;
-   T_arg3 arg3;
-   T_arg4 arg4;
-   T_arg5 arg5;
-   T_arg6 arg6;
-   if ( cbptr ) {
-     if ( get_arg_count( theEnv ) != 6 )
-       throw std::logic_error( "clipsmm: wrong # args on slot callback; expected 6" );
-     get_argument( theEnv, 1, arg1 );
-     get_argument( theEnv, 2, arg2 );
-     get_argument( theEnv, 3, arg3 );
-     get_argument( theEnv, 4, arg4 );
-     get_argument( theEnv, 5, arg5 );
-     get_argument( theEnv, 6, arg6 );
-     cb = static_cast<sigc::slot6<T_return, T_arg1, T_arg2,T_arg3,T_arg4,T_arg5,T_arg6>*>( cbptr );
-     return ( *cb ) ( arg1, arg2, arg3, arg4, arg5, arg6 );
-   }
-   throw;
- }
-
-  template < typename T_return, typename T_arg1, typename T_arg2, typename T_arg3, typename T_arg4, typename T_arg5, typename T_arg6, typename T_arg7 >
-  inline
-  T_return Environment::callback( void* theEnv ) {
-    sigc::slot7<T_return,T_arg1,T_arg2,T_arg3,T_arg4,T_arg5,T_arg6,T_arg7>* cb;
-    void * cbptr = get_function_context( theEnv );
-    T_arg1 arg1;
-    T_arg2 arg2;
-    T_arg3 arg3;
-    T_arg4 arg4;
-    T_arg5 arg5;
-    T_arg6 arg6;
-    T_arg7 arg7;
-    if ( cbptr ) {
-      if ( get_arg_count( theEnv ) != 7 )
-        throw std::logic_error( "clipsmm: wrong # args on slot callback; expected 7" );
-      get_argument( theEnv, 1, arg1 );
-      get_argument( theEnv, 2, arg2 );
-      get_argument( theEnv, 3, arg3 );
-      get_argument( theEnv, 4, arg4 );
-      get_argument( theEnv, 5, arg5 );
-      get_argument( theEnv, 6, arg6 );
-      get_argument( theEnv, 7, arg7 );
-      cb = static_cast<sigc::slot7<T_return, T_arg1, T_arg2,T_arg3,T_arg4,T_arg5,T_arg6,T_arg7>*>( cbptr );
-      return ( *cb ) ( arg1, arg2, arg3, arg4, arg5, arg6, arg7 );
-    }
-    throw;
+  typename FunctionTraits<T_callable>::return_type Environment::callback( void* theEnv ) {
+    return call_function<T_callable>( theEnv );
   }
 
-  inline
-  void Environment::callback_multifield( void* theEnv, void *rv) {
-    sigc::slot0<Values>* cb;
-    void * cbptr = get_function_context( theEnv );
-    if ( cbptr ) {
-      if ( get_arg_count( theEnv ) != 0 )
-        throw std::logic_error( "clipsmm/mf: wrong # args on slot callback; expected 0" );
-      cb = static_cast<sigc::slot0<Values>*>( cbptr );
-      Values v = ( *cb ) ();
-      set_return_values(theEnv, rv, v);
-      return;
-    }
-    throw;
-  }
-
-  template <typename T_arg1>
-  inline
-  void Environment::callback_multifield( void* theEnv, void *rv) {
-    sigc::slot1<Values, T_arg1>* cb;
-    void * cbptr = get_function_context( theEnv );
-    T_arg1 arg1;
-    if ( cbptr ) {
-      if ( get_arg_count( theEnv ) != 1 )
-        throw std::logic_error( "clipsmm/mf: wrong # args on slot callback; expected 1" );
-      cb = static_cast<sigc::slot1<Values, T_arg1>*>( cbptr );
-      get_argument(theEnv, 1, arg1);
-      Values v = ( *cb ) (arg1);
-      set_return_values(theEnv, rv, v);
-      return;
-    }
-    throw;
-  }
-
-  template <typename T_arg1, typename T_arg2>
-  inline
-  void Environment::callback_multifield( void* theEnv, void *rv) {
-    sigc::slot2<Values, T_arg1, T_arg2>* cb;
-    void * cbptr = get_function_context( theEnv );
-    T_arg1 arg1;
-    T_arg2 arg2;
-    if ( cbptr ) {
-      if ( get_arg_count( theEnv ) != 2 )
-        throw std::logic_error( "clipsmm/mf: wrong # args on slot callback; expected 2" );
-      cb = static_cast<sigc::slot2<Values, T_arg1, T_arg2>*>( cbptr );
-      get_argument(theEnv, 1, arg1);
-      get_argument(theEnv, 2, arg2);
-      Values v = ( *cb ) (arg1, arg2);
-      set_return_values(theEnv, rv, v);
-      return;
-    }
-    throw;
-  }
-
-
-  template <typename T_arg1, typename T_arg2, typename T_arg3>
-  inline
-  void Environment::callback_multifield( void* theEnv, void *rv) {
-    sigc::slot3<Values, T_arg1, T_arg2, T_arg3>* cb;
-    void * cbptr = get_function_context( theEnv );
-    T_arg1 arg1;
-    T_arg2 arg2;
-    T_arg3 arg3;
-    if ( cbptr ) {
-      if ( get_arg_count( theEnv ) != 3 )
-        throw std::logic_error( "clipsmm/mf: wrong # args on slot callback; expected 3" );
-      cb = static_cast<sigc::slot3<Values, T_arg1, T_arg2, T_arg3>*>( cbptr );
-      get_argument(theEnv, 1, arg1);
-      get_argument(theEnv, 2, arg2);
-      get_argument(theEnv, 3, arg3);
-      Values v = ( *cb ) (arg1, arg2, arg3);
-      set_return_values(theEnv, rv, v);
-      return;
-    }
-    throw;
-  }
-
-  template <typename T_arg1, typename T_arg2, typename T_arg3, typename T_arg4>
-  inline
-  void Environment::callback_multifield( void* theEnv, void *rv) {
-    sigc::slot4<Values, T_arg1, T_arg2, T_arg3, T_arg4>* cb;
-    void * cbptr = get_function_context( theEnv );
-    T_arg1 arg1;
-    T_arg2 arg2;
-    T_arg3 arg3;
-    T_arg4 arg4;
-    if ( cbptr ) {
-      if ( get_arg_count( theEnv ) != 4 )
-        throw std::logic_error( "clipsmm/mf: wrong # args on slot callback; expected 4" );
-      cb = static_cast<sigc::slot4<Values, T_arg1, T_arg2, T_arg3, T_arg4>*>(cbptr);
-      get_argument(theEnv, 1, arg1);
-      get_argument(theEnv, 2, arg2);
-      get_argument(theEnv, 3, arg3);
-      get_argument(theEnv, 4, arg4);
-      Values v = ( *cb ) (arg1, arg2, arg3, arg4);
-      set_return_values(theEnv, rv, v);
-      return;
-    }
-    throw;
-  }
-
-  template <typename T_arg1, typename T_arg2, typename T_arg3, typename T_arg4,
-    typename T_arg5>
-  inline
-  void Environment::callback_multifield( void* theEnv, void *rv) {
-      sigc::slot5<Values, T_arg1, T_arg2, T_arg3, T_arg4, T_arg5>* cb;
-    void * cbptr = get_function_context( theEnv );
-    T_arg1 arg1;
-    T_arg2 arg2;
-    T_arg3 arg3;
-    T_arg4 arg4;
-    T_arg5 arg5;
-    if ( cbptr ) {
-      if ( get_arg_count( theEnv ) != 5 )
-        throw std::logic_error( "clipsmm/mf: wrong # args on slot callback; expected 5" );
-      cb = static_cast<sigc::slot5<Values, T_arg1, T_arg2, T_arg3,
-        T_arg4, T_arg5>*>(cbptr);
-      get_argument(theEnv, 1, arg1);
-      get_argument(theEnv, 2, arg2);
-      get_argument(theEnv, 3, arg3);
-      get_argument(theEnv, 4, arg4);
-      get_argument(theEnv, 5, arg5);
-      Values v = ( *cb ) (arg1, arg2, arg3, arg4, arg5);
-      set_return_values(theEnv, rv, v);
-      return;
-    }
-    throw;
-  }
-
-
-  template <typename T_arg1, typename T_arg2, typename T_arg3, typename T_arg4,
-    typename T_arg5, typename T_arg6>
-  inline
-  void Environment::callback_multifield( void* theEnv, void *rv) {
-    sigc::slot6<Values, T_arg1, T_arg2, T_arg3, T_arg4, T_arg5, T_arg6>* cb;
-    void * cbptr = get_function_context( theEnv );
-    T_arg1 arg1;
-    T_arg2 arg2;
-    T_arg3 arg3;
-    T_arg4 arg4;
-    T_arg5 arg5;
-    T_arg6 arg6;
-    if ( cbptr ) {
-      if ( get_arg_count( theEnv ) != 6 )
-        throw std::logic_error( "clipsmm/mf: wrong # args on slot callback; expected 6" );
-      cb = static_cast<sigc::slot6<Values, T_arg1, T_arg2, T_arg3,
-        T_arg4, T_arg5, T_arg6>*>(cbptr);
-      get_argument(theEnv, 1, arg1);
-      get_argument(theEnv, 2, arg2);
-      get_argument(theEnv, 3, arg3);
-      get_argument(theEnv, 4, arg4);
-      get_argument(theEnv, 5, arg5);
-      get_argument(theEnv, 6, arg6);
-      Values v = ( *cb ) (arg1, arg2, arg3, arg4, arg5, arg6);
-      set_return_values(theEnv, rv, v);
-      return;
-    }
-    throw;
-  }
-
-  template <typename T_arg1, typename T_arg2, typename T_arg3, typename T_arg4,
-    typename T_arg5, typename T_arg6, typename T_arg7>
-  inline
-  void Environment::callback_multifield( void* theEnv, void *rv) {
-    sigc::slot7<Values, T_arg1, T_arg2, T_arg3, T_arg4, T_arg5, T_arg6, T_arg7>* cb;
-    void * cbptr = get_function_context( theEnv );
-    T_arg1 arg1;
-    T_arg2 arg2;
-    T_arg3 arg3;
-    T_arg4 arg4;
-    T_arg5 arg5;
-    T_arg6 arg6;
-    T_arg7 arg7;
-    if ( cbptr ) {
-      if ( get_arg_count( theEnv ) != 7 )
-        throw std::logic_error( "clipsmm/mf: wrong # args on slot callback; expected 7" );
-      cb = static_cast<sigc::slot7<Values, T_arg1, T_arg2, T_arg3,
-        T_arg4, T_arg5, T_arg6, T_arg7>*>(cbptr);
-      get_argument(theEnv, 1, arg1);
-      get_argument(theEnv, 2, arg2);
-      get_argument(theEnv, 3, arg3);
-      get_argument(theEnv, 4, arg4);
-      get_argument(theEnv, 5, arg5);
-      get_argument(theEnv, 6, arg6);
-      get_argument(theEnv, 7, arg7);
-      Values v = ( *cb ) (arg1, arg2, arg3, arg4, arg5, arg6, arg7);
-      set_return_values(theEnv, rv, v);
-      return;
-    }
-    throw;
-  }
-
-
-  // **************************************************************************************
-
-  inline
-  void Environment::callback_unknown( void* theEnv, void *rv) {
-    sigc::slot0<Value>* cb;
-    void * cbptr = get_function_context( theEnv );
-    if ( cbptr ) {
-      if ( get_arg_count( theEnv ) != 0 )
-        throw std::logic_error( "clipsmm/mf: wrong # args on slot callback; expected 0" );
-      cb = static_cast<sigc::slot0<Value>*>( cbptr );
-      Value v = ( *cb ) ();
-      set_return_value(theEnv, rv, v);
-      return;
-    }
-    throw;
-  }
-
-  template <typename T_arg1>
-  inline
-  void Environment::callback_unknown( void* theEnv, void *rv) {
-    sigc::slot1<Value, T_arg1>* cb;
-    void * cbptr = get_function_context( theEnv );
-    T_arg1 arg1;
-    if ( cbptr ) {
-      if ( get_arg_count( theEnv ) != 1 )
-        throw std::logic_error( "clipsmm/mf: wrong # args on slot callback; expected 1" );
-      cb = static_cast<sigc::slot1<Value, T_arg1>*>( cbptr );
-      get_argument(theEnv, 1, arg1);
-      Value v = ( *cb ) (arg1);
-      set_return_value(theEnv, rv, v);
-      return;
-    }
-    throw;
-  }
-
-  template <typename T_arg1, typename T_arg2>
-  inline
-  void Environment::callback_unknown( void* theEnv, void *rv) {
-    sigc::slot2<Value, T_arg1, T_arg2>* cb;
-    void * cbptr = get_function_context( theEnv );
-    T_arg1 arg1;
-    T_arg2 arg2;
-    if ( cbptr ) {
-      if ( get_arg_count( theEnv ) != 2 )
-        throw std::logic_error( "clipsmm/mf: wrong # args on slot callback; expected 2" );
-      cb = static_cast<sigc::slot2<Value, T_arg1, T_arg2>*>( cbptr );
-      get_argument(theEnv, 1, arg1);
-      get_argument(theEnv, 2, arg2);
-      Value v = ( *cb ) (arg1, arg2);
-      set_return_value(theEnv, rv, v);
-      return;
-    }
-    throw;
-  }
-
-
-  template <typename T_arg1, typename T_arg2, typename T_arg3>
-  inline
-  void Environment::callback_unknown( void* theEnv, void *rv) {
-    sigc::slot3<Value, T_arg1, T_arg2, T_arg3>* cb;
-    void * cbptr = get_function_context( theEnv );
-    T_arg1 arg1;
-    T_arg2 arg2;
-    T_arg3 arg3;
-    if ( cbptr ) {
-      if ( get_arg_count( theEnv ) != 3 )
-        throw std::logic_error( "clipsmm/mf: wrong # args on slot callback; expected 3" );
-      cb = static_cast<sigc::slot3<Value, T_arg1, T_arg2, T_arg3>*>( cbptr );
-      get_argument(theEnv, 1, arg1);
-      get_argument(theEnv, 2, arg2);
-      get_argument(theEnv, 3, arg3);
-      Value v = ( *cb ) (arg1, arg2, arg3);
-      set_return_value(theEnv, rv, v);
-      return;
-    }
-    throw;
-  }
-
-  template <typename T_arg1, typename T_arg2, typename T_arg3, typename T_arg4>
-  inline
-  void Environment::callback_unknown( void* theEnv, void *rv) {
-    sigc::slot4<Value, T_arg1, T_arg2, T_arg3, T_arg4>* cb;
-    void * cbptr = get_function_context( theEnv );
-    T_arg1 arg1;
-    T_arg2 arg2;
-    T_arg3 arg3;
-    T_arg4 arg4;
-    if ( cbptr ) {
-      if ( get_arg_count( theEnv ) != 4 )
-        throw std::logic_error( "clipsmm/mf: wrong # args on slot callback; expected 4" );
-      cb = static_cast<sigc::slot4<Value, T_arg1, T_arg2, T_arg3, T_arg4>*>(cbptr);
-      get_argument(theEnv, 1, arg1);
-      get_argument(theEnv, 2, arg2);
-      get_argument(theEnv, 3, arg3);
-      get_argument(theEnv, 4, arg4);
-      Value v = ( *cb ) (arg1, arg2, arg3, arg4);
-      set_return_value(theEnv, rv, v);
-      return;
-    }
-    throw;
-  }
-
-  template <typename T_arg1, typename T_arg2, typename T_arg3, typename T_arg4,
-    typename T_arg5>
-  inline
-  void Environment::callback_unknown( void* theEnv, void *rv) {
-      sigc::slot5<Value, T_arg1, T_arg2, T_arg3, T_arg4, T_arg5>* cb;
-    void * cbptr = get_function_context( theEnv );
-    T_arg1 arg1;
-    T_arg2 arg2;
-    T_arg3 arg3;
-    T_arg4 arg4;
-    T_arg5 arg5;
-    if ( cbptr ) {
-      if ( get_arg_count( theEnv ) != 5 )
-        throw std::logic_error( "clipsmm/mf: wrong # args on slot callback; expected 5" );
-      cb = static_cast<sigc::slot5<Value, T_arg1, T_arg2, T_arg3,
-        T_arg4, T_arg5>*>(cbptr);
-      get_argument(theEnv, 1, arg1);
-      get_argument(theEnv, 2, arg2);
-      get_argument(theEnv, 3, arg3);
-      get_argument(theEnv, 4, arg4);
-      get_argument(theEnv, 5, arg5);
-      Value v = ( *cb ) (arg1, arg2, arg3, arg4, arg5);
-      set_return_value(theEnv, rv, v);
-      return;
-    }
-    throw;
-  }
-
-
-  template <typename T_arg1, typename T_arg2, typename T_arg3, typename T_arg4,
-    typename T_arg5, typename T_arg6>
-  inline
-  void Environment::callback_unknown( void* theEnv, void *rv) {
-    sigc::slot6<Value, T_arg1, T_arg2, T_arg3, T_arg4, T_arg5, T_arg6>* cb;
-    void * cbptr = get_function_context( theEnv );
-    T_arg1 arg1;
-    T_arg2 arg2;
-    T_arg3 arg3;
-    T_arg4 arg4;
-    T_arg5 arg5;
-    T_arg6 arg6;
-    if ( cbptr ) {
-      if ( get_arg_count( theEnv ) != 6 )
-        throw std::logic_error( "clipsmm/mf: wrong # args on slot callback; expected 6" );
-      cb = static_cast<sigc::slot6<Value, T_arg1, T_arg2, T_arg3,
-        T_arg4, T_arg5, T_arg6>*>(cbptr);
-      get_argument(theEnv, 1, arg1);
-      get_argument(theEnv, 2, arg2);
-      get_argument(theEnv, 3, arg3);
-      get_argument(theEnv, 4, arg4);
-      get_argument(theEnv, 5, arg5);
-      get_argument(theEnv, 6, arg6);
-      Value v = ( *cb ) (arg1, arg2, arg3, arg4, arg5, arg6);
-      set_return_value(theEnv, rv, v);
-      return;
-    }
-    throw;
-  }
-
-  template <typename T_arg1, typename T_arg2, typename T_arg3, typename T_arg4,
-    typename T_arg5, typename T_arg6, typename T_arg7>
-  inline
-  void Environment::callback_unknown( void* theEnv, void *rv) {
-    sigc::slot7<Value, T_arg1, T_arg2, T_arg3, T_arg4, T_arg5, T_arg6, T_arg7>* cb;
-    void * cbptr = get_function_context( theEnv );
-    T_arg1 arg1;
-    T_arg2 arg2;
-    T_arg3 arg3;
-    T_arg4 arg4;
-    T_arg5 arg5;
-    T_arg6 arg6;
-    T_arg7 arg7;
-    if ( cbptr ) {
-      if ( get_arg_count( theEnv ) != 7 )
-        throw std::logic_error( "clipsmm/mf: wrong # args on slot callback; expected 7" );
-      cb = static_cast<sigc::slot7<Value, T_arg1, T_arg2, T_arg3,
-        T_arg4, T_arg5, T_arg6, T_arg7>*>(cbptr);
-      get_argument(theEnv, 1, arg1);
-      get_argument(theEnv, 2, arg2);
-      get_argument(theEnv, 3, arg3);
-      get_argument(theEnv, 4, arg4);
-      get_argument(theEnv, 5, arg5);
-      get_argument(theEnv, 6, arg6);
-      get_argument(theEnv, 7, arg7);
-      Value v = ( *cb ) (arg1, arg2, arg3, arg4, arg5, arg6, arg7);
-      set_return_value(theEnv, rv, v);
-      return;
-    }
-    throw;
-  }
-
-  // **************************************************************************************
-
-
+  template <typename T_callable>
   inline
   void* Environment::strcallback( void* theEnv ) {
-    sigc::slot0<std::string>* cb;
-    void * cbptr = get_function_context( theEnv );
-    if ( cbptr ) {
-      if ( get_arg_count( theEnv ) != 0 )
-        throw std::logic_error( "clipsmm/string: wrong # args on slot callback; expected 0" );
-      cb = static_cast<sigc::slot0<std::string>*>( cbptr );
-      return add_symbol( theEnv, ( ( *cb ) ( )).c_str() );
-    }
-    throw;
+    return add_symbol( theEnv, call_function<T_callable>( theEnv ).c_str() );
   }
 
-  template < typename T_arg1 >
+  template <typename T_callable>
   inline
-  void* Environment::strcallback( void* theEnv ) {
-    sigc::slot1<std::string,T_arg1>* cb;
-    void * cbptr = get_function_context( theEnv );
-    T_arg1 arg1;
-    if ( cbptr ) {
-      if ( get_arg_count( theEnv ) != 1 )
-        throw std::logic_error( "clipsmm: wrong # args on slot callback; expected 1" );
-      get_argument( theEnv, 1, arg1 );
-      cb = static_cast<sigc::slot1<std::string,T_arg1>*>( cbptr );
-      return add_symbol( theEnv, ( ( *cb ) ( arg1 )).c_str() );
-    }
-    throw;
+  void Environment::callback_multifield( void* theEnv, void *rv ) {
+    set_return_values( theEnv, rv, call_function<T_callable>( theEnv ) );
   }
 
-  template < typename T_arg1, typename T_arg2 >
+  template <typename T_callable>
   inline
-  void* Environment::strcallback( void* theEnv ) {
-    sigc::slot2<std::string, T_arg1, T_arg2>* cb;
-    void * cbptr = get_function_context( theEnv );
-    T_arg1 arg1;
-    T_arg2 arg2;
-    if ( cbptr ) {
-      if ( get_arg_count( theEnv ) != 2 )
-        throw std::logic_error( "clipsmm: wrong # args on slot callback; expected 2" );
-      get_argument( theEnv, 1, arg1 );
-      get_argument( theEnv, 2, arg2 );
-      cb = static_cast<sigc::slot2<std::string, T_arg1, T_arg2>*>( cbptr );
-      return add_symbol( theEnv, ( ( *cb ) ( arg1, arg2 )).c_str() );
-    }
-    throw;
+  void Environment::callback_unknown( void* theEnv, void *rv ) {
+    set_return_value( theEnv, rv, call_function<T_callable>( theEnv ) );
   }
 
-  template < typename T_arg1, typename T_arg2, typename T_arg3 >
+  template <typename T_callable>
   inline
-  void* Environment::strcallback( void* theEnv ) {
-    sigc::slot3<std::string,T_arg1,T_arg2,T_arg3>* cb;
-    void * cbptr = get_function_context( theEnv );
-    T_arg1 arg1;
-    T_arg2 arg2;
-    T_arg3 arg3;
-    if ( cbptr ) {
-      if ( get_arg_count( theEnv ) != 3 )
-        throw std::logic_error( "clipsmm: wrong # args on slot callback; expected 3" );
-      get_argument( theEnv, 1, arg1 );
-      get_argument( theEnv, 2, arg2 );
-      get_argument( theEnv, 3, arg3 );
-      cb = static_cast<sigc::slot3<std::string, T_arg1, T_arg2,T_arg3>*>( cbptr );
-      return add_symbol( theEnv, ( ( *cb ) ( arg1, arg2, arg3 )).c_str() );
-    }
-    throw;
+  bool Environment::add_callable( const std::string& name, const T_callable& callable ) {
+    typedef typename FunctionTraits<T_callable>::return_type T_return;
+    const char retcode = get_return_code<T_return>( );
+    // CLIPS keeps the pointer, the string has static storage duration
+    const char* argstring = TupleRestriction<typename FunctionTraits<T_callable>::argument_tuple>::value;
+    UserFunctionImpl<T_callable>* function = new UserFunctionImpl<T_callable>( callable );
+    function->set_profiling( m_function_profiling );
+    function->set_registration( retcode, get_callback<T_callable>( ReturnTag<T_return>() ), argstring );
+    return define_function( name, UserFunction::pointer( function ) );
   }
 
-  template < typename T_arg1, typename T_arg2, typename T_arg3, typename T_arg4 >
+  template <typename... T_args>
   inline
-  void* Environment::strcallback( void* theEnv ) {
-    sigc::slot4<std::string,T_arg1,T_arg2,T_arg3,T_arg4>* cb;
-    void * cbptr = get_function_context( theEnv );
-    T_arg1 arg1;
-    T_arg2 arg2;
-    T_arg3 arg3;
-    T_arg4 arg4;
-    std::string s;
-    if ( cbptr ) {
-      if ( get_arg_count( theEnv ) != 4 )
-        throw std::logic_error( "clipsmm: wrong # args on slot callback; expected 4" );
-      get_argument( theEnv, 1, arg1 );
-      get_argument( theEnv, 2, arg2 );
-      get_argument( theEnv, 3, arg3 );
-      get_argument( theEnv, 4, arg4 );
-      cb = static_cast<sigc::slot4<std::string, T_arg1, T_arg2,T_arg3,T_arg4>*>( cbptr );
-      s = ( *cb ) ( arg1, arg2, arg3, arg4 );
-      return add_symbol( theEnv, s.c_str() );
-    }
-    throw;
+  Values Environment::call( const std::string& function_name, const T_args&... arguments ) {
+    // The leading element avoids a zero-length array
+    const Value values[] = { Value(), Value( arguments )... };
+    return call( function_name, values + 1, sizeof...( T_args ) );
   }
 
-  template < typename T_arg1, typename T_arg2, typename T_arg3, typename T_arg4, typename T_arg5 >
+  template <typename T_callable>
   inline
-  void* Environment::strcallback( void* theEnv ) {
-    sigc::slot5<std::string,T_arg1,T_arg2,T_arg3,T_arg4,T_arg5>* cb;
-    void * cbptr = get_function_context( theEnv );
-    T_arg1 arg1;
-    T_arg2 arg2;
-    T_arg3 arg3;
-    T_arg4 arg4;
-    T_arg5 arg5;
-    if ( cbptr ) {
-      if ( get_arg_count( theEnv ) != 5 )
-        throw std::logic_error( "clipsmm: wrong # args on slot callback; expected 5" );
-      get_argument( theEnv, 1, arg1 );
-      get_argument( theEnv, 2, arg2 );
-      get_argument( theEnv, 3, arg3 );
-      get_argument( theEnv, 4, arg4 );
-      get_argument( theEnv, 5, arg5 );
-      cb = static_cast<sigc::slot5<std::string, T_arg1, T_arg2,T_arg3,T_arg4,T_arg5>*>( cbptr );
-      return add_symbol( theEnv, ( ( *cb ) ( arg1, arg2, arg3, arg4, arg5 )).c_str() );
-    }
-    throw;
+  bool Environment::add_function( std::string name, const T_callable& callable ) {
+    return add_callable<typename std::decay<T_callable>::type>( name, callable );
   }
 
-  template < typename T_arg1, typename T_arg2, typename T_arg3, typename T_arg4, typename T_arg5, typename T_arg6 >
-  inline
-  void* Environment::strcallback( void* theEnv ) {
-    sigc::slot6<std::string,T_arg1,T_arg2,T_arg3,T_arg4,T_arg5,T_arg6>* cb;
-    void * cbptr = get_function_context( theEnv );
-    T_arg1 arg1;
-    T_arg2 arg2;
-    T_arg3 arg3;
-    T_arg4 arg4;
-    T_arg5 arg5;
-    T_arg6 arg6;
-    if ( cbptr ) {
-      if ( get_arg_count( theEnv ) != 6 )
-        throw std::logic_error( "clipsmm: wrong # args on slot callback; expected 6" );
-      get_argument( theEnv, 1, arg1 );
-      get_argument( theEnv, 2, arg2 );
-      get_argument( theEnv, 3, arg3 );
-      get_argument( theEnv, 4, arg4 );
-      get_argument( theEnv, 5, arg5 );
-      get_argument( theEnv, 6, arg6 );
-      cb = static_cast<sigc::slot6<std::string, T_arg1, T_arg2,T_arg3,T_arg4,T_arg5,T_arg6>*>( cbptr );
-      return add_symbol( theEnv, ( ( *cb ) ( arg1, arg2, arg3, arg4, arg5, arg6 )).c_str() );
-    }
-    throw;
-  }
-
-  template < typename T_arg1, typename T_arg2, typename T_arg3, typename T_arg4, typename T_arg5, typename T_arg6, typename T_arg7 >
-  inline
-  void* Environment::strcallback( void* theEnv ) {
-    sigc::slot7<std::string,T_arg1,T_arg2,T_arg3,T_arg4,T_arg5,T_arg6,T_arg7>* cb;
-    void * cbptr = get_function_context( theEnv );
-    T_arg1 arg1;
-    T_arg2 arg2;
-    T_arg3 arg3;
-    T_arg4 arg4;
-    T_arg5 arg5;
-    T_arg6 arg6;
-    T_arg7 arg7;
-    if ( cbptr ) {
-      if ( get_arg_count( theEnv ) != 7 )
-        throw std::logic_error( "clipsmm: wrong # args on slot callback; expected 7" );
-      get_argument( theEnv, 1, arg1 );
-      get_argument( theEnv, 2, arg2 );
-      get_argument( theEnv, 3, arg3 );
-      get_argument( theEnv, 4, arg4 );
-      get_argument( theEnv, 5, arg5 );
-      get_argument( theEnv, 6, arg6 );
-      get_argument( theEnv, 7, arg7 );
-      cb = static_cast<sigc::slot7<std::string, T_arg1, T_arg2,T_arg3,T_arg4,T_arg5,T_arg6,T_arg7>*>( cbptr );
-      return add_symbol( theEnv, ( ( *cb ) ( arg1, arg2, arg3, arg4, arg5, arg6, arg7 )).c_str() );
-    }
-    throw;
-  }
-
-template < typename T_return >
+  template < typename T_return >
   inline
   bool Environment::add_function( std::string name, const sigc::slot0<T_return>& slot) {
-    char retcode = get_return_code<T_return>( );
-    char *argstring = get_function_restriction(name);
-    sigc::slot0<T_return>* scb = new sigc::slot0<T_return>(slot);
-    any holder = CLIPSPointer<sigc::slot0<T_return> >(scb);
-    m_slots[name] = holder;
-    return ( EnvDefineFunction2WithContext( m_cobj,
-                                 name.c_str(),
-                                 retcode,
-                                 get_callback(slot),
-                                 name.c_str(),
-                                 argstring,
-                                 ( void* ) scb ) );
+    return add_callable( name, slot );
   }
 
   template < typename T_return, typename T_arg1 >
   inline
   bool Environment::add_function( std::string name, const sigc::slot1<T_return, T_arg1>& slot) {
-    char retcode = get_return_code<T_return>( );
-    char *argstring = get_function_restriction<T_arg1>(name);
-    sigc::slot1<T_return, T_arg1>* scb = new sigc::slot1<T_return, T_arg1>(slot);
-    any holder = CLIPSPointer<sigc::slot1<T_return, T_arg1> >(scb);
-    m_slots[name] = holder;
-    return ( EnvDefineFunction2WithContext( m_cobj,
-                                 name.c_str(),
-                                 retcode,
-                                 get_callback(slot),
-                                 name.c_str(),
-                                 argstring,
-                                 scb ) );
+    return add_callable( name, slot );
   }
 
   template < typename T_return, typename T_arg1, typename T_arg2 >
   inline
   bool Environment::add_function( std::string name, const sigc::slot2<T_return, T_arg1, T_arg2>& slot) {
-    char retcode = get_return_code<T_return>( );
-    char *argstring = get_function_restriction<T_arg1,T_arg2>(name);
-    sigc::slot2<T_return, T_arg1, T_arg2>* scb = new sigc::slot2<T_return, T_arg1, T_arg2>(slot);
-    any holder = CLIPSPointer<sigc::slot2<T_return, T_arg1, T_arg2> >(scb);
-    m_slots[name] = holder;
-    return ( EnvDefineFunction2WithContext( m_cobj,
-                                 name.c_str(),
-                                 retcode,
-                                 get_callback(slot),
-                                 name.c_str(),
-                                 argstring,
-                                 scb ) );
+    return add_callable( name, slot );
   }
 
   template < typename T_return, typename T_arg1, typename T_arg2, typename T_arg3 >
   inline
   bool Environment::add_function( std::string name, const sigc::slot3<T_return,T_arg1,T_arg2,T_arg3>& slot) {
-    char retcode = get_return_code<T_return>( );
-    char *argstring = get_function_restriction<T_arg1,T_arg2,T_arg3>(name);
-    sigc::slot3<T_return,T_arg1,T_arg2,T_arg3>* scb =
-        new sigc::slot3<T_return,T_arg1,T_arg2,T_arg3>(slot);
-    any holder = CLIPSPointer<sigc::slot3<T_return,T_arg1,T_arg2,T_arg3> >(scb);
-    m_slots[name] = holder;
-    return ( EnvDefineFunction2WithContext( m_cobj,
-                                 name.c_str(),
-                                 retcode,
-                                 get_callback(slot),
-                                 name.c_str(),
-                                 argstring,
-                                 scb )
-           );
+    return add_callable( name, slot );
   }
 
   template < typename T_return, typename T_arg1, typename T_arg2, typename T_arg3, typename T_arg4 >
   inline
   bool Environment::add_function( std::string name, const sigc::slot4<T_return,T_arg1,T_arg2,T_arg3,T_arg4>& slot) {
-    char retcode = get_return_code<T_return>( );
-    char *argstring = get_function_restriction<T_arg1,T_arg2,T_arg3,T_arg4>(name);
-    sigc::slot4<T_return,T_arg1,T_arg2,T_arg3,T_arg4>* scb =
-        new sigc::slot4<T_return,T_arg1,T_arg2,T_arg3,T_arg4>(slot);
-    any holder = CLIPSPointer<sigc::slot4<T_return,T_arg1,T_arg2,T_arg3,T_arg4> >(scb);
-    m_slots[name] = holder;
-    return ( EnvDefineFunction2WithContext( m_cobj,
-                                 name.c_str(),
-                                 retcode,
-                                 get_callback(slot),
-                                 name.c_str(),
-                                 argstring,
-                                 scb )
-           );
+    return add_callable( name, slot );
   }
 
   template < typename T_return, typename T_arg1, typename T_arg2, typename T_arg3, typename T_arg4, typename T_arg5 >
   inline
   bool Environment::add_function( std::string name,
-                              const sigc::slot5<T_return,T_arg1,T_arg2,T_arg3,T_arg4,T_arg5>& slot) {
-    char retcode = get_return_code<T_return>( );
-    char *argstring = get_function_restriction<T_arg1,T_arg2,T_arg3,T_arg4,T_arg5>(name);
-    sigc::slot5<T_return,T_arg1,T_arg2,T_arg3,T_arg4,T_arg5>* scb =
-        new sigc::slot5<T_return,T_arg1,T_arg2,T_arg3,T_arg4,T_arg5>(slot);
-    any holder = CLIPSPointer<sigc::slot5<T_return,T_arg1,T_arg2,T_arg3,T_arg4,T_arg5> >(scb);
-    m_slots[name] = holder;
-    return ( EnvDefineFunction2WithContext( m_cobj,
-                                 name.c_str(),
-                                 retcode,
-                                 get_callback(slot),
-                                 name.c_str(),
-                                 argstring,
-                                 scb )
-           );
+                                  const sigc::slot5<T_return,T_arg1,T_arg2,T_arg3,T_arg4,T_arg5>& slot) {
+    return add_callable( name, slot );
   }
 
   template < typename T_return, typename T_arg1, typename T_arg2, typename T_arg3, typename T_arg4, typename T_arg5, typename T_arg6 >
   inline
   bool Environment::add_function( std::string name,
-                              const sigc::slot6<T_return,T_arg1,T_arg2,T_arg3,T_arg4,T_arg5,T_arg6>& slot) {
-    char retcode = get_return_code<T_return>( );
-    char *argstring = get_function_restriction<T_arg1,T_arg2,T_arg3,T_arg4,T_arg5,T_arg6>(name);
-    sigc::slot6<T_return,T_arg1,T_arg2,T_arg3,T_arg4,T_arg5,T_arg6>* scb =
-        new sigc::slot6<T_return,T_arg1,T_arg2,T_arg3,T_arg4,T_arg5,T_arg6>(slot);
-    any holder = CLIPSPointer<sigc::slot6<T_return,T_arg1,T_arg2,T_arg3,T_arg4,T_arg5,T_arg6> >(scb);
-    m_slots[name] = holder;
-    return ( EnvDefineFunction2WithContext( m_cobj,
-                                 name.c_str(),
-                                 retcode,
-                                 get_callback(slot),
-                                 name.c_str(),
-                                 argstring,
-                                 scb )
-           );
+                                  const sigc::slot6<T_return,T_arg1,T_arg2,T_arg3,T_arg4,T_arg5,T_arg6>& slot) {
+    return add_callable( name, slot );
   }
 
   template < typename T_return, typename T_arg1, typename T_arg2, typename T_arg3, typename T_arg4, typename T_arg5, typename T_arg6, typename T_arg7 >
   inline
   bool Environment::add_function( std::string name,
                                   const sigc::slot7<T_return,T_arg1,T_arg2,T_arg3,T_arg4,T_arg5,T_arg6,T_arg7>& slot) {
-    char retcode = get_return_code<T_return>( );
-    char *argstring = get_function_restriction<T_arg1,T_arg2,T_arg3,T_arg4,T_arg5,T_arg6,T_arg7>(name);
-    sigc::slot7<T_return,T_arg1,T_arg2,T_arg3,T_arg4,T_arg5,T_arg6,T_arg7>* scb =
-        new sigc::slot7<T_return,T_arg1,T_arg2,T_arg3,T_arg4,T_arg5,T_arg6,T_arg7>(slot);
-    any holder = CLIPSPointer<sigc::slot7<T_return,T_arg1,T_arg2,T_arg3,T_arg4,T_arg5,T_arg6,T_arg7> >(scb);
-    m_slots[name] = holder;
-    return ( EnvDefineFunction2WithContext( m_cobj,
-                                 name.c_str(),
-                                 retcode,
-                                 get_callback(slot),
-                                 name.c_str(),
-                                 argstring,
-                                 scb )
-           );
+    return add_callable( name, slot );
   }
-
 }
 
 
@@ -0,0 +1,202 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by the clipsmm developers                          *
+ *                                                                         *
+ *   This file is part of the clipsmm library.                             *
+ *                                                                         *
+ *   The clipsmm library is free software; you can redistribute it and/or  *
+ *   modify it under the terms of the GNU General Public License           *
+ *   version 3 as published by the Free Software Foundation.               *
+ *                                                                         *
+ *   The clipsmm library is distributed in the hope that it will be        *
+ *   useful, but WITHOUT ANY WARRANTY; without even the implied warranty   *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU   *
+ *   General Public License for more details.                              *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this software. If not see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+#include "environmentgroup.h"
+
+#include <functional>
+#include <stdexcept>
+
+namespace CLIPS {
+
+EnvironmentGroup::EnvironmentGroup( unsigned int num_shards ):
+  m_have_key_function(false)
+{
+  if ( num_shards == 0 )
+    throw std::logic_error( "clipsmm: environment group needs at least one shard" );
+
+  for ( unsigned int i = 0; i < num_shards; ++i )
+    m_shards.push_back( Environment::pointer( new Environment() ) );
+  m_executed.resize( num_shards, 0 );
+}
+
+EnvironmentGroup::pointer EnvironmentGroup::create( unsigned int num_shards )
+{
+  return EnvironmentGroup::pointer( new EnvironmentGroup( num_shards ) );
+}
+
+EnvironmentGroup::~EnvironmentGroup()
+{
+  join_run_threads();
+}
+
+unsigned int EnvironmentGroup::size() const
+{
+  return m_shards.size();
+}
+
+Environment& EnvironmentGroup::shard( unsigned int index )
+{
+  if ( index >= m_shards.size() )
+    throw std::out_of_range( "clipsmm: shard index out of range" );
+  return *m_shards[index];
+}
+
+unsigned int EnvironmentGroup::shard_index( const std::string& key ) const
+{
+  return std::hash<std::string>()( key ) % m_shards.size();
+}
+
+void EnvironmentGroup::set_key_function( const sigc::slot<std::string, const std::string&>& key_function )
+{
+  m_key_function = key_function;
+  m_have_key_function = true;
+}
+
+int EnvironmentGroup::load( const std::string& filename )
+{
+  int rv = 1;
+  for ( unsigned int i = 0; i < m_shards.size(); ++i ) {
+    int shard_rv = m_shards[i]->load( filename );
+    // 0 (file not found) is worse than -1 (errors while loading)
+    if ( shard_rv == 0 || ( shard_rv < rv && rv != 0 ) )
+      rv = shard_rv;
+  }
+  return rv;
+}
+
+bool EnvironmentGroup::binary_load( const std::string& filename )
+{
+  bool rv = true;
+  for ( unsigned int i = 0; i < m_shards.size(); ++i )
+    rv = m_shards[i]->binary_load( filename ) && rv;
+  return rv;
+}
+
+bool EnvironmentGroup::batch_evaluate( const std::string& filename )
+{
+  bool rv = true;
+  for ( unsigned int i = 0; i < m_shards.size(); ++i )
+    rv = m_shards[i]->batch_evaluate( filename ) && rv;
+  return rv;
+}
+
+bool EnvironmentGroup::build( const std::string& construct )
+{
+  bool rv = true;
+  for ( unsigned int i = 0; i < m_shards.size(); ++i )
+    rv = m_shards[i]->build( construct ) && rv;
+  return rv;
+}
+
+void EnvironmentGroup::reset()
+{
+  for ( unsigned int i = 0; i < m_shards.size(); ++i )
+    m_shards[i]->reset();
+}
+
+Fact::pointer EnvironmentGroup::assert_fact( const std::string& factstring )
+{
+  if ( ! m_have_key_function )
+    throw std::logic_error( "clipsmm: no key function set for environment group" );
+  return m_shards[shard_index( m_key_function( factstring ) )]->assert_fact( factstring );
+}
+
+Fact::pointer EnvironmentGroup::assert_fact( const std::string& key, const std::string& factstring )
+{
+  return m_shards[shard_index( key )]->assert_fact( factstring );
+}
+
+void EnvironmentGroup::run_shard( unsigned int index, long int runlimit )
+{
+  m_executed[index] = m_shards[index]->run( runlimit );
+}
+
+long int EnvironmentGroup::run( long int runlimit )
+{
+  std::vector<Glib::Thread*> threads;
+
+  try {
+    // The calling thread runs the first shard itself
+    for ( unsigned int i = 1; i < m_shards.size(); ++i )
+      threads.push_back( Glib::Thread::create( sigc::bind( sigc::mem_fun( *this, &EnvironmentGroup::run_shard ),
+                                                           i, runlimit ),
+                                               true ) );
+    run_shard( 0, runlimit );
+  } catch ( ... ) {
+    // The started threads refer to this group, they must not outlive the call
+    for ( unsigned int i = 0; i < threads.size(); ++i )
+      threads[i]->join();
+    throw;
+  }
+
+  for ( unsigned int i = 0; i < threads.size(); ++i )
+    threads[i]->join();
+
+  long int executed = 0;
+  for ( unsigned int i = 0; i < m_executed.size(); ++i )
+    executed += m_executed[i];
+  return executed;
+}
+
+bool EnvironmentGroup::run_threaded( long int runlimit, int priority )
+{
+  bool rv = true;
+  for ( unsigned int i = 0; i < m_shards.size(); ++i )
+    rv = m_shards[i]->run_threaded( runlimit, priority ) && rv;
+  return rv;
+}
+
+void EnvironmentGroup::join_run_threads()
+{
+  for ( unsigned int i = 0; i < m_shards.size(); ++i )
+    m_shards[i]->join_run_thread();
+}
+
+std::vector<Values> EnvironmentGroup::evaluate( const std::string& expression )
+{
+  std::vector<Values> results;
+  results.reserve( m_shards.size() );
+  for ( unsigned int i = 0; i < m_shards.size(); ++i )
+    results.push_back( m_shards[i]->evaluate( expression ) );
+  return results;
+}
+
+std::vector<Values> EnvironmentGroup::function( const std::string& function_name,
+                                                const std::string& arguments )
+{
+  std::vector<Values> results;
+  results.reserve( m_shards.size() );
+  for ( unsigned int i = 0; i < m_shards.size(); ++i )
+    results.push_back( m_shards[i]->function( function_name, arguments ) );
+  return results;
+}
+
+std::vector<Values> EnvironmentGroup::global_values( const std::string& global_name )
+{
+  std::vector<Values> results;
+  results.reserve( m_shards.size() );
+  for ( unsigned int i = 0; i < m_shards.size(); ++i ) {
+    Global::pointer global = m_shards[i]->get_global( global_name );
+    if ( global )
+      results.push_back( global->value() );
+    else
+      results.push_back( Values() );
+  }
+  return results;
+}
+
+}
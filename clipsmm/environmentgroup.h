@@ -0,0 +1,170 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by the clipsmm developers                          *
+ *                                                                         *
+ *   This file is part of the clipsmm library.                             *
+ *                                                                         *
+ *   The clipsmm library is free software; you can redistribute it and/or  *
+ *   modify it under the terms of the GNU General Public License           *
+ *   version 3 as published by the Free Software Foundation.               *
+ *                                                                         *
+ *   The clipsmm library is distributed in the hope that it will be        *
+ *   useful, but WITHOUT ANY WARRANTY; without even the implied warranty   *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU   *
+ *   General Public License for more details.                              *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this software. If not see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+#ifndef CLIPSENVIRONMENTGROUP_H
+#define CLIPSENVIRONMENTGROUP_H
+
+#include <string>
+#include <vector>
+
+#include <sigc++/sigc++.h>
+
+#include <clipsmm/environment.h>
+
+namespace CLIPS {
+
+/**
+ * A group of environments sharing the same constructs.
+ *
+ * The group holds a fixed number of Environment shards. Constructs are
+ * loaded into every shard using the regular Environment methods, so all
+ * shards start out identically. Facts are routed to exactly one shard,
+ * selected by hashing a key. The key is either passed explicitly or
+ * extracted from the fact string by a user-supplied key function. This
+ * allows rule bases that are partitionable by some key (for example a
+ * customer id) to use more than one core, since each shard can run in
+ * its own thread.
+ *
+ * Queries such as evaluate() or global_values() are executed on every
+ * shard and return one result per shard, in shard order.
+ */
+class EnvironmentGroup : public sigc::trackable
+{
+  public:
+    typedef CLIPSPointer<EnvironmentGroup> pointer;
+
+    /** Creates a group of num_shards environments, at least one. */
+    EnvironmentGroup( unsigned int num_shards );
+
+    static EnvironmentGroup::pointer create( unsigned int num_shards );
+
+    ~EnvironmentGroup();
+
+    /** Returns the number of shards in this group */
+    unsigned int size() const;
+
+    /** Returns the shard with the given index */
+    Environment& shard( unsigned int index );
+
+    /** Returns the index of the shard the given key is routed to */
+    unsigned int shard_index( const std::string& key ) const;
+
+    /**
+     * Sets the function extracting the routing key from a fact string.
+     * It is used by assert_fact( const std::string& ).
+     */
+    void set_key_function( const sigc::slot<std::string, const std::string&>& key_function );
+
+    /**
+     * Loads a set of constructs into every shard.
+     * @return the worst result returned by Environment::load() for any shard
+     */
+    int load( const std::string& filename );
+
+    /**
+     * Loads a binary image of constructs into every shard.
+     * @return true if all shards loaded the image, false otherwise
+     */
+    bool binary_load( const std::string& filename );
+
+    /**
+     * Evaluates a series of commands in every shard.
+     * @return true if all shards succeeded, false otherwise
+     */
+    bool batch_evaluate( const std::string& filename );
+
+    /**
+     * Defines a construct in every shard.
+     * @return true if all shards succeeded, false otherwise
+     */
+    bool build( const std::string& construct );
+
+    /**
+     * Adds a function to every shard.
+     * Takes the same slot types as Environment::add_function().
+     * @return true if all shards succeeded, false otherwise
+     */
+    template <typename T_slot>
+    bool add_function( const std::string& name, const T_slot& slot );
+
+    /** Resets every shard */
+    void reset();
+
+    /**
+     * Asserts a fact into the shard selected by the key function.
+     * @exception std::logic_error thrown if no key function has been set
+     */
+    Fact::pointer assert_fact( const std::string& factstring );
+
+    /** Asserts a fact into the shard selected by key */
+    Fact::pointer assert_fact( const std::string& key, const std::string& factstring );
+
+    /**
+     * Runs all shards in parallel, each in its own thread, and waits
+     * until all of them finished.
+     * @param runlimit How many rules should fire per shard, negative to
+     * fire until the agendas are empty
+     * @return the total number of rules fired over all shards
+     */
+    long int run( long int runlimit = -1 );
+
+    /**
+     * Calls Environment::run_threaded() on every shard
+     * @return false if the execution thread of a shard could not be started
+     */
+    bool run_threaded( long int runlimit = -1, int priority = 0 );
+
+    /** Waits until the execution threads of all shards are finished */
+    void join_run_threads();
+
+    /** Evaluates an expression in every shard */
+    std::vector<Values> evaluate( const std::string& expression );
+
+    /** Calls a CLIPS function in every shard */
+    std::vector<Values> function( const std::string& function_name,
+                                  const std::string& arguments=std::string() );
+
+    /**
+     * Gets the value of a global from every shard.
+     * Shards which do not define the global contribute an empty value.
+     */
+    std::vector<Values> global_values( const std::string& global_name );
+
+  protected:
+    std::vector<Environment::pointer> m_shards;
+    sigc::slot<std::string, const std::string&> m_key_function;
+    bool m_have_key_function;
+
+    /** Run results of the shards, written by the run threads in run() */
+    std::vector<long int> m_executed;
+
+    void run_shard( unsigned int index, long int runlimit );
+};
+
+template <typename T_slot>
+inline
+bool EnvironmentGroup::add_function( const std::string& name, const T_slot& slot )
+{
+  bool rv = true;
+  for ( unsigned int i = 0; i < m_shards.size(); ++i )
+    rv = m_shards[i]->add_function( name, slot ) && rv;
+  return rv;
+}
+
+}
+
+#endif
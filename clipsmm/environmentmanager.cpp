@@ -0,0 +1,187 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by the clipsmm developers                          *
+ *                                                                         *
+ *   This file is part of the clipsmm library.                             *
+ *                                                                         *
+ *   The clipsmm library is free software; you can redistribute it and/or  *
+ *   modify it under the terms of the GNU General Public License           *
+ *   version 3 as published by the Free Software Foundation.               *
+ *                                                                         *
+ *   The clipsmm library is distributed in the hope that it will be        *
+ *   useful, but WITHOUT ANY WARRANTY; without even the implied warranty   *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU   *
+ *   General Public License for more details.                              *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this software. If not see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+#include "environmentmanager.h"
+
+#include <chrono>
+#include <cstdio>
+#include <sstream>
+#include <unistd.h>
+
+extern "C" {
+  #include <clips/clips.h>
+};
+
+namespace CLIPS {
+
+EnvironmentManager::Stats::Stats():
+  hits(0), misses(0), restore_failures(0), created(0), evictions(0), restore_time(0), resident(0), resident_memory(0)
+{ }
+
+double EnvironmentManager::Stats::hit_rate() const
+{
+  return ( hits + misses ) ? static_cast<double>( hits ) / ( hits + misses ) : 0;
+}
+
+double EnvironmentManager::Stats::mean_restore_time() const
+{
+  return misses ? restore_time / misses : 0;
+}
+
+EnvironmentManager::EnvironmentManager( Environment::pointer prototype, const std::string& spill_dir,
+                                        unsigned int max_resident, long int max_memory ):
+  m_prototype(prototype),
+  m_spill_dir(spill_dir),
+  m_max_resident(max_resident),
+  m_max_memory(max_memory),
+  m_next_checkpoint(0)
+{
+  if ( ! m_prototype )
+    throw std::logic_error( "clipsmm: environment manager needs a prototype environment" );
+}
+
+EnvironmentManager::pointer EnvironmentManager::create( Environment::pointer prototype, const std::string& spill_dir,
+                                                        unsigned int max_resident, long int max_memory )
+{
+  return EnvironmentManager::pointer( new EnvironmentManager( prototype, spill_dir, max_resident, max_memory ) );
+}
+
+EnvironmentManager::~EnvironmentManager()
+{
+  std::map<std::string, Tenant>::iterator t;
+  for ( t = m_tenants.begin(); t != m_tenants.end(); ++t )
+    if ( ! t->second.environment )
+      unlink( t->second.checkpoint.c_str() );
+}
+
+Environment::pointer EnvironmentManager::get( const std::string& tenant )
+{
+  Glib::Mutex::Lock lock( m_mutex );
+
+  std::map<std::string, Tenant>::iterator t = m_tenants.find( tenant );
+  if ( t != m_tenants.end() && t->second.environment ) {
+    ++m_stats.hits;
+    m_lru.splice( m_lru.begin(), m_lru, t->second.lru );
+    return t->second.environment;
+  }
+
+  Environment::pointer environment = m_prototype->clone();
+  if ( ! environment )
+    return Environment::pointer();
+
+  if ( t != m_tenants.end() ) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    if ( ! environment->restore( t->second.checkpoint ) ) {
+      ++m_stats.restore_failures;
+      return Environment::pointer();
+    }
+    m_stats.restore_time += std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+    ++m_stats.misses;
+    unlink( t->second.checkpoint.c_str() );
+  } else {
+    t = m_tenants.insert( std::make_pair( tenant, Tenant() ) ).first;
+    std::ostringstream checkpoint;
+    checkpoint << m_spill_dir << "/tenant-" << getpid() << "-" << m_next_checkpoint++ << ".ckpt";
+    t->second.checkpoint = checkpoint.str();
+    ++m_stats.created;
+  }
+
+  t->second.environment = environment;
+  m_lru.push_front( tenant );
+  t->second.lru = m_lru.begin();
+  // environment is referenced here, so the tenant itself is not evicted
+  enforce_limits();
+  return environment;
+}
+
+bool EnvironmentManager::evict( const std::string& tenant )
+{
+  Glib::Mutex::Lock lock( m_mutex );
+
+  std::map<std::string, Tenant>::iterator t = m_tenants.find( tenant );
+  if ( t == m_tenants.end() )
+    return false;
+  return evict( t->second );
+}
+
+void EnvironmentManager::remove( const std::string& tenant )
+{
+  Glib::Mutex::Lock lock( m_mutex );
+
+  std::map<std::string, Tenant>::iterator t = m_tenants.find( tenant );
+  if ( t == m_tenants.end() )
+    return;
+  if ( t->second.environment )
+    m_lru.erase( t->second.lru );
+  else
+    unlink( t->second.checkpoint.c_str() );
+  m_tenants.erase( t );
+}
+
+EnvironmentManager::Stats EnvironmentManager::stats()
+{
+  Glib::Mutex::Lock lock( m_mutex );
+
+  m_stats.resident = m_lru.size();
+  m_stats.resident_memory = 0;
+  for ( std::list<std::string>::iterator i = m_lru.begin(); i != m_lru.end(); ++i )
+    m_stats.resident_memory += EnvMemUsed( m_tenants[*i].environment->cobj() );
+  return m_stats;
+}
+
+void EnvironmentManager::reset_stats()
+{
+  Glib::Mutex::Lock lock( m_mutex );
+  m_stats = Stats();
+}
+
+bool EnvironmentManager::evict( Tenant& tenant )
+{
+  if ( ! tenant.environment || tenant.environment.use_count() > 1 )
+    return false;
+  if ( ! tenant.environment->checkpoint( tenant.checkpoint ) )
+    return false;
+  tenant.environment.reset();
+  m_lru.erase( tenant.lru );
+  ++m_stats.evictions;
+  return true;
+}
+
+void EnvironmentManager::enforce_limits()
+{
+  long int memory = 0;
+  if ( m_max_memory > 0 )
+    for ( std::list<std::string>::iterator i = m_lru.begin(); i != m_lru.end(); ++i )
+      memory += EnvMemUsed( m_tenants[*i].environment->cobj() );
+
+  std::list<std::string>::iterator i = m_lru.end();
+  while ( i != m_lru.begin() &&
+          ( ( m_max_resident > 0 && m_lru.size() > m_max_resident ) ||
+            ( m_max_memory > 0 && memory > m_max_memory ) ) ) {
+    --i;
+    Tenant& tenant = m_tenants[*i];
+    long int used = EnvMemUsed( tenant.environment->cobj() );
+    std::list<std::string>::iterator next = i;
+    ++next;
+    if ( evict( tenant ) ) {
+      memory -= used;
+      i = next;
+    }
+  }
+}
+
+}
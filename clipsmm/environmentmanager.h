@@ -0,0 +1,144 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by the clipsmm developers                          *
+ *                                                                         *
+ *   This file is part of the clipsmm library.                             *
+ *                                                                         *
+ *   The clipsmm library is free software; you can redistribute it and/or  *
+ *   modify it under the terms of the GNU General Public License           *
+ *   version 3 as published by the Free Software Foundation.               *
+ *                                                                         *
+ *   The clipsmm library is distributed in the hope that it will be        *
+ *   useful, but WITHOUT ANY WARRANTY; without even the implied warranty   *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU   *
+ *   General Public License for more details.                              *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this software. If not see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+#ifndef CLIPSENVIRONMENTMANAGER_H
+#define CLIPSENVIRONMENTMANAGER_H
+
+#include <string>
+#include <list>
+#include <map>
+
+#include <glibmm.h>
+
+#include <clipsmm/environment.h>
+
+namespace CLIPS {
+
+/**
+ * Keeps the environments of many tenants, of which only some are resident.
+ *
+ * All tenant environments are clones of a prototype environment and share
+ * its binary construct image, see Environment::clone(). When more than the
+ * configured number of environments, or more than the configured memory,
+ * is resident, the least recently used environments are evicted: their
+ * working memory is written to a checkpoint in the spill directory and
+ * the environment is destroyed. The next get() for an evicted tenant
+ * clones the prototype again and restores the checkpoint.
+ *
+ * Only working memory survives eviction, constructs a tenant defined
+ * itself are lost. Environments that are still referenced outside of the
+ * manager are not evicted.
+ *
+ * \warning The agenda and refraction are not part of a checkpoint. The
+ * restored facts are asserted anew, so rules that already fired for them
+ * are activated and fire again on the next run. Tenants that must not
+ * repeat actions have to record that in facts or globals, or be run
+ * before they can be evicted.
+ */
+class EnvironmentManager
+{
+  public:
+    typedef CLIPSPointer<EnvironmentManager> pointer;
+
+    /** Counters and gauges of the manager */
+    struct Stats {
+      Stats();
+      unsigned long int hits; /**< get() calls for resident environments */
+      unsigned long int misses; /**< get() calls that restored an evicted environment */
+      unsigned long int restore_failures; /**< get() calls that could not restore an evicted environment */
+      unsigned long int created; /**< get() calls for new tenants */
+      unsigned long int evictions;
+      double restore_time; /**< Total seconds spent restoring evicted environments */
+      unsigned long int resident; /**< Environments currently resident */
+      long int resident_memory; /**< Bytes CLIPS holds for the resident environments */
+
+      /** The fraction of get() calls for known tenants that found them resident */
+      double hit_rate() const;
+
+      /** Seconds a restore took on average */
+      double mean_restore_time() const;
+    };
+
+    /**
+     * @param prototype the environment tenant environments are cloned from
+     * @param spill_dir the directory checkpoints of evicted environments are written to
+     * @param max_resident how many environments may be resident, 0 for no limit
+     * @param max_memory how many bytes resident environments may use, 0 for no limit
+     */
+    EnvironmentManager( Environment::pointer prototype, const std::string& spill_dir,
+                        unsigned int max_resident, long int max_memory = 0 );
+
+    static EnvironmentManager::pointer create( Environment::pointer prototype, const std::string& spill_dir,
+                                               unsigned int max_resident, long int max_memory = 0 );
+
+    /** Removes the checkpoints of evicted environments */
+    ~EnvironmentManager();
+
+    /**
+     * Returns the environment of a tenant, restoring it if it was evicted
+     * and cloning the prototype for new tenants. Environments of other
+     * tenants may be evicted. If the checkpoint of an evicted tenant cannot
+     * be restored, the tenant stays evicted and keeps its checkpoint, so a
+     * later get() may retry. remove() gives up on the tenant.
+     * @return a null pointer if the environment could not be cloned or restored
+     */
+    Environment::pointer get( const std::string& tenant );
+
+    /**
+     * Evicts the environment of a tenant
+     * @return false if the tenant is unknown or not resident, its environment
+     * is still referenced or the checkpoint could not be written
+     */
+    bool evict( const std::string& tenant );
+
+    /** Forgets a tenant, removing its environment or checkpoint */
+    void remove( const std::string& tenant );
+
+    /** Returns the counters, with resident and resident_memory taken now */
+    Stats stats();
+
+    /** Resets the counters */
+    void reset_stats();
+
+  protected:
+    struct Tenant {
+      Environment::pointer environment; /**< Null while evicted */
+      std::string checkpoint; /**< The checkpoint file, written when evicted */
+      std::list<std::string>::iterator lru; /**< Position in m_lru while resident */
+    };
+
+    Environment::pointer m_prototype;
+    std::string m_spill_dir;
+    unsigned int m_max_resident;
+    long int m_max_memory;
+    unsigned long int m_next_checkpoint;
+
+    std::map<std::string, Tenant> m_tenants;
+    std::list<std::string> m_lru; /**< Resident tenants, most recently used first */
+    Stats m_stats;
+    Glib::Mutex m_mutex;
+
+    /** Evicts a resident tenant, m_mutex must be locked */
+    bool evict( Tenant& tenant );
+
+    /** Evicts least recently used environments until the limits are met */
+    void enforce_limits();
+};
+
+}
+
+#endif
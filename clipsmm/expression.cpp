@@ -0,0 +1,166 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by the clipsmm developers                          *
+ *                                                                         *
+ *   This file is part of the clipsmm library.                             *
+ *                                                                         *
+ *   The clipsmm library is free software; you can redistribute it and/or  *
+ *   modify it under the terms of the GNU General Public License           *
+ *   version 3 as published by the Free Software Foundation.               *
+ *                                                                         *
+ *   The clipsmm library is distributed in the hope that it will be        *
+ *   useful, but WITHOUT ANY WARRANTY; without even the implied warranty   *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU   *
+ *   General Public License for more details.                              *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this software. If not see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+#include "expression.h"
+
+extern "C" {
+  #include <clips/clips.h>
+};
+
+#include <clipsmm/environment.h>
+#include <clipsmm/factory.h>
+
+namespace CLIPS {
+
+Expression::Expression( Environment& environment, void* cobj, const std::string& expression ) :
+    EnvironmentObject( environment, cobj ),
+    m_text( expression )
+{
+  collect_parameters( m_cobj );
+  m_environment.m_expressions.insert( this );
+}
+
+Expression::pointer Expression::create( Environment& environment, void* cobj, const std::string& expression ) {
+  return Expression::pointer( new Expression( environment, cobj, expression ) );
+}
+
+Expression::~Expression()
+{
+  if ( m_cobj ) {
+    m_environment.m_expressions.erase( this );
+    invalidate();
+  }
+}
+
+void Expression::collect_parameters( void* node )
+{
+  for ( struct expr* e = static_cast<struct expr*>( node ); e != NULL; e = e->nextArg ) {
+    if ( e->type == SF_VARIABLE )
+      m_parameters[ ValueToString( e->value ) ].nodes.push_back( e );
+    collect_parameters( e->argList );
+  }
+}
+
+bool Expression::is_valid() const
+{
+  return m_cobj != NULL;
+}
+
+const std::string& Expression::text() const
+{
+  return m_text;
+}
+
+std::vector<std::string> Expression::parameters() const
+{
+  std::vector<std::string> names;
+  std::map<std::string, Parameter>::const_iterator i;
+  for ( i = m_parameters.begin(); i != m_parameters.end(); ++i )
+    names.push_back( i->first );
+  return names;
+}
+
+bool Expression::bind( const std::string& name, const Value& value )
+{
+  if ( ! m_cobj )
+    return false;
+
+  switch ( value.type() ) {
+    case TYPE_FLOAT:
+    case TYPE_INTEGER:
+    case TYPE_SYMBOL:
+    case TYPE_STRING:
+    case TYPE_INSTANCE_NAME:
+      break;
+    default:
+      return false;
+  }
+
+  std::string key = ( ! name.empty() && name[0] == '?' ) ? name.substr( 1 ) : name;
+  std::map<std::string, Parameter>::iterator p = m_parameters.find( key );
+  if ( p == m_parameters.end() )
+    return false;
+
+  void* env = m_environment.cobj();
+  DATA_OBJECT clipsdo;
+  value_to_data_object_rawenv( env, value, &clipsdo );
+
+  for ( unsigned int i = 0; i < p->second.nodes.size(); ++i ) {
+    struct expr* node = static_cast<struct expr*>( p->second.nodes[i] );
+    AtomInstall( env, GetType( clipsdo ), GetValue( clipsdo ) );
+    AtomDeinstall( env, node->type, node->value );
+    node->type = GetType( clipsdo );
+    node->value = GetValue( clipsdo );
+  }
+  p->second.bound = true;
+  return true;
+}
+
+Values Expression::evaluate()
+{
+  Values result;
+  evaluate( result );
+  return result;
+}
+
+bool Expression::evaluate( Values& result )
+{
+  if ( ! m_cobj )
+    return evaluate_prepared( result );
+  m_environment.begin_evaluation();
+  bool ok = evaluate_prepared( result );
+  m_environment.code_ran();
+  return ok;
+}
+
+bool Expression::evaluate_prepared( Values& result )
+{
+  result.clear();
+  if ( ! m_cobj )
+    return false;
+
+  std::map<std::string, Parameter>::const_iterator p;
+  for ( p = m_parameters.begin(); p != m_parameters.end(); ++p )
+    if ( ! p->second.bound )
+      return false;
+
+  void* env = m_environment.cobj();
+  DATA_OBJECT clipsdo;
+
+  EnvSetEvaluationError( env, FALSE );
+  EvaluateExpression( env, static_cast<struct expr*>( m_cobj ), &clipsdo );
+  if ( EnvGetEvaluationError( env ) )
+    return false;
+
+  data_object_to_values( clipsdo, result );
+  return true;
+}
+
+void Expression::invalidate()
+{
+  if ( ! m_cobj )
+    return;
+
+  void* env = m_environment.cobj();
+  struct expr* top = static_cast<struct expr*>( m_cobj );
+  ExpressionDeinstall( env, top );
+  ReturnExpression( env, top );
+  m_cobj = NULL;
+  m_parameters.clear();
+}
+
+}
@@ -0,0 +1,108 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by the clipsmm developers                          *
+ *                                                                         *
+ *   This file is part of the clipsmm library.                             *
+ *                                                                         *
+ *   The clipsmm library is free software; you can redistribute it and/or  *
+ *   modify it under the terms of the GNU General Public License           *
+ *   version 3 as published by the Free Software Foundation.               *
+ *                                                                         *
+ *   The clipsmm library is distributed in the hope that it will be        *
+ *   useful, but WITHOUT ANY WARRANTY; without even the implied warranty   *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU   *
+ *   General Public License for more details.                              *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this software. If not see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+#ifndef CLIPSEXPRESSION_H
+#define CLIPSEXPRESSION_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <clipsmm/value.h>
+#include <clipsmm/environmentobject.h>
+
+namespace CLIPS {
+
+/**
+ * A parsed CLIPS expression that can be evaluated repeatedly.
+ *
+ * Expressions are created by Environment::prepare(). Parsing and
+ * building the expression tree happen once, each evaluation only walks
+ * the tree. Single-field variables like ?x in the expression are
+ * parameters, which must be bound to a value with bind() before the
+ * expression is evaluated. Global variables are read on evaluation.
+ *
+ * The expression is invalidated when the environment is cleared, since
+ * it may refer to constructs that no longer exist. An invalid expression
+ * evaluates to an error and has to be prepared again.
+ */
+class Expression : public EnvironmentObject
+{
+  public:
+    typedef CLIPSPointer<Expression> pointer;
+
+    Expression( Environment& environment, void* cobj, const std::string& expression );
+
+    static Expression::pointer create( Environment& environment, void* cobj, const std::string& expression );
+
+    ~Expression();
+
+    /** True until the environment is cleared or destroyed */
+    bool is_valid() const;
+
+    /** The text the expression was prepared from */
+    const std::string& text() const;
+
+    /** Names of the parameters, without the leading question mark */
+    std::vector<std::string> parameters() const;
+
+    /**
+     * Binds a parameter to a single-field value.
+     * @param name parameter name, with or without leading question mark
+     * @return false if the expression has no such parameter, the value
+     * is not a number, symbol, string or instance name, or the expression
+     * is invalid
+     */
+    bool bind( const std::string& name, const Value& value );
+
+    /**
+     * Evaluates the expression.
+     * @return the result, empty on errors
+     */
+    Values evaluate();
+
+    /**
+     * Evaluates the expression into a caller provided container.
+     * @return true on success, false if parameters are unbound, the
+     * expression is invalid or evaluation failed
+     */
+    bool evaluate( Values& result );
+
+  protected:
+    friend class Environment;
+
+    /** Releases the CLIPS expression, called when the environment is cleared */
+    void invalidate();
+
+    /** Evaluates without the top level setup, which the caller has done */
+    bool evaluate_prepared( Values& result );
+
+    struct Parameter {
+      Parameter(): bound(false) { }
+      std::vector<void*> nodes; /**< Expression nodes referring to the parameter */
+      bool bound;
+    };
+
+    std::string m_text;
+    std::map<std::string, Parameter> m_parameters;
+
+    void collect_parameters( void* node );
+};
+
+}
+
+#endif
@@ -184,4 +184,56 @@ Fact::refcount() const
   return f->factHeader.busyCount;
 }
 
+
+bool FactRef::exists() const
+{
+  if ( m_cobj )
+    return EnvFactExistp( m_env, m_cobj );
+  return false;
+}
+
+long int FactRef::index() const
+{
+  if ( m_cobj )
+    return EnvFactIndex( m_env, m_cobj );
+  return -1;
+}
+
+Values FactRef::slot_value( const std::string& slot_name ) const
+{
+  DATA_OBJECT data_object;
+  if ( ! m_cobj )
+    return Values();
+  if ( ! EnvGetFactSlot( m_env, m_cobj, slot_name.empty() ? NULL : slot_name.c_str(), &data_object ) )
+    return Values();
+  return data_object_to_values( data_object );
+}
+
+Fact::pointer FactRef::fact( Environment& environment ) const
+{
+  if ( ! m_cobj )
+    return Fact::pointer();
+  return Fact::create( environment, m_cobj );
+}
+
+void get_argument( void* env, int argposition, Fact::pointer& value )
+{
+  DATA_OBJECT obj;
+  EnvRtnUnknown( env, argposition, &obj );
+  if ( GetType( obj ) == FACT_ADDRESS )
+    value = Fact::create( *Environment::m_environment_map[env], GetValue( obj ) );
+  else
+    value = Fact::pointer();
+}
+
+void get_argument( void* env, int argposition, FactRef& value )
+{
+  DATA_OBJECT obj;
+  EnvRtnUnknown( env, argposition, &obj );
+  if ( GetType( obj ) == FACT_ADDRESS )
+    value = FactRef( env, GetValue( obj ) );
+  else
+    value = FactRef();
+}
+
 }
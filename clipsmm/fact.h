@@ -90,6 +90,41 @@ public:
 
 };
 
+/**
+ * A non-owning reference to a fact, e.g. a fact-address argument of a
+ * user function. Unlike Fact it is not allocated on the heap and does
+ * not keep the fact alive, so it may only be used while the fact
+ * exists, typically for the duration of the function call.
+ */
+class FactRef {
+public:
+  FactRef(): m_env( NULL ), m_cobj( NULL ) { }
+
+  FactRef( void* env, void* cobj ): m_env( env ), m_cobj( cobj ) { }
+
+  /** The underlying CLIPS fact, NULL for an empty reference */
+  void* cobj() const { return m_cobj; }
+
+  /** True if the reference is not empty */
+  operator bool() const { return m_cobj != NULL; }
+
+  /** Indicates whether the fact is still in the fact list */
+  bool exists() const;
+
+  /** Returns the fact index, or -1 for an empty reference */
+  long int index() const;
+
+  /** Return the values contained within a slot, "" for ordered facts */
+  Values slot_value( const std::string& slot_name ) const;
+
+  /** Creates a Fact that keeps the fact alive */
+  Fact::pointer fact( Environment& environment ) const;
+
+protected:
+  void* m_env;
+  void* m_cobj;
+};
+
 }
 
 #endif
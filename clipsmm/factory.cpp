@@ -35,6 +35,12 @@ namespace CLIPS {
 
   Values data_object_to_values( dataObject& clipsdo ) {
     Values values;
+    data_object_to_values( clipsdo, values );
+    return values;
+  }
+
+  void data_object_to_values( dataObject& clipsdo, Values& values ) {
+    values.clear();
 
     std::string s;
     double d;
@@ -46,35 +52,39 @@ namespace CLIPS {
   
     switch ( GetType( clipsdo ) ) {
     case RVOID:
-      return values;
+      return;
     case STRING:
       s = DOToString( clipsdo );
       values.push_back( Value( s, TYPE_STRING ) );
-      return values;
+      return;
     case INSTANCE_NAME:
       s = DOToString( clipsdo );
       values.push_back( Value( s, TYPE_INSTANCE_NAME ) );
-      return values;
+      return;
     case SYMBOL:
       s = DOToString( clipsdo );
       values.push_back( Value( s, TYPE_SYMBOL ) );
-      return values;
+      return;
     case FLOAT:
       d = DOToDouble( clipsdo );
       values.push_back( Value( d ) );
-      return values;
+      return;
     case INTEGER:
       i = DOToLong( clipsdo );
       values.push_back( Value( i ) );
-      return values;
+      return;
+    case FACT_ADDRESS:
+      p = DOToPointer( clipsdo );
+      values.push_back( Value( p, TYPE_FACT_ADDRESS ) );
+      return;
     case INSTANCE_ADDRESS:
       p = DOToPointer( clipsdo );
       values.push_back( Value( p, TYPE_INSTANCE_ADDRESS ) );
-      return values;
+      return;
     case EXTERNAL_ADDRESS:
       p = (((struct externalAddressHashNode *) (clipsdo.value))->externalAddress);
       values.push_back( Value( p, TYPE_EXTERNAL_ADDRESS ) );
-      return values;
+      return;
     case MULTIFIELD:
       end = GetDOEnd( clipsdo );
       mfptr = GetValue( clipsdo );
@@ -100,11 +110,16 @@ namespace CLIPS {
 	  p = ValueToExternalAddress( GetMFValue( mfptr, iter ) );
 	  values.push_back( Value( p, TYPE_EXTERNAL_ADDRESS ) );
 	  break;
+	case FACT_ADDRESS:
+	case INSTANCE_ADDRESS:
+	  p = GetMFValue( mfptr, iter );
+	  values.push_back( Value( p, GetMFType( mfptr, iter ) == FACT_ADDRESS ? TYPE_FACT_ADDRESS : TYPE_INSTANCE_ADDRESS ) );
+	  break;
 	default:
 	  throw std::logic_error( "clipsmm::data_object_to_values: Unhandled multifield type" );
 	}
       }
-      return values;
+      return;
     default:
       //std::cout << std::endl << "Type: " << GetType(clipsdo) << std::endl;
       throw std::logic_error( "clipsmm::data_object_to_values: Unhandled data object type" );
@@ -150,6 +165,10 @@ namespace CLIPS {
         p = EnvAddExternalAddress( env, value.as_address(), EXTERNAL_ADDRESS );
         SetpValue(clipsdo, p);
         return clipsdo;
+      case TYPE_FACT_ADDRESS:
+      case TYPE_INSTANCE_ADDRESS:
+        SetpValue(clipsdo, value.as_address());
+        return clipsdo;
       default:
         throw std::logic_error( "clipsmm::value_to_data_object: Unhandled data object type" );
     }
@@ -200,6 +219,10 @@ namespace CLIPS {
         p2 = EnvAddExternalAddress( env, values[iter].as_address(), EXTERNAL_ADDRESS );
 	SetMFValue(p, mfi, p2);
 	break;
+      case TYPE_FACT_ADDRESS:
+      case TYPE_INSTANCE_ADDRESS:
+	SetMFValue(p, mfi, values[iter].as_address());
+	break;
         default:
           throw std::logic_error( "clipsmm::value_to_data_object: Unhandled data object type" );
       }
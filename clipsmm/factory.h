@@ -31,6 +31,8 @@ namespace CLIPS {
   /** TODO Move to utility, since these are no longer factory methods */
   Values data_object_to_values(dataObject* clipsdo);
   Values data_object_to_values(dataObject& clipsdo);
+  /** Replaces the contents of values, keeping its capacity */
+  void data_object_to_values(dataObject& clipsdo, Values& values);
 
   dataObject* value_to_data_object(const Environment& env, const Values& values,
 				   dataObject *obj = NULL);
@@ -89,9 +89,10 @@ bool Function::is_deletable() {
 }
 
 bool Function::undefine() {
-  if ( m_cobj )
-    return EnvUndeffunction( m_environment.cobj(), m_cobj );
-  return false;
+  if ( ! m_cobj || ! EnvUndeffunction( m_environment.cobj(), m_cobj ) )
+    return false;
+  m_environment.constructs_changed();
+  return true;
 }
 
 }
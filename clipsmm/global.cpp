@@ -122,9 +122,10 @@ bool Global::is_deletable() {
 }
 
 bool Global::undefine() {
-  if ( m_cobj )
-    return EnvUndefglobal( m_environment.cobj(), m_cobj );
-  return false;
+  if ( ! m_cobj || ! EnvUndefglobal( m_environment.cobj(), m_cobj ) )
+    return false;
+  m_environment.constructs_changed();
+  return true;
 }
 
 }
@@ -0,0 +1,95 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by the clipsmm developers                          *
+ *                                                                         *
+ *   This file is part of the clipsmm library.                             *
+ *                                                                         *
+ *   The clipsmm library is free software; you can redistribute it and/or  *
+ *   modify it under the terms of the GNU General Public License           *
+ *   version 3 as published by the Free Software Foundation.               *
+ *                                                                         *
+ *   The clipsmm library is distributed in the hope that it will be        *
+ *   useful, but WITHOUT ANY WARRANTY; without even the implied warranty   *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU   *
+ *   General Public License for more details.                              *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this software. If not see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+#include "multifieldview.h"
+
+extern "C" {
+  #include <clips/clips.h>
+};
+
+namespace CLIPS {
+
+  MultifieldView::MultifieldView():
+    m_multifield(NULL), m_begin(0), m_size(0)
+  {
+  }
+
+  MultifieldView::MultifieldView( void* multifield, long int begin, long int end ):
+    m_multifield(multifield), m_begin(begin), m_size( end >= begin ? end - begin + 1 : 0 )
+  {
+  }
+
+  Type MultifieldView::type( std::size_t index ) const
+  {
+    return static_cast<Type>( GetMFType( m_multifield, m_begin + index ) );
+  }
+
+  double MultifieldView::as_float( std::size_t index ) const
+  {
+    long int i = m_begin + index;
+    if ( GetMFType( m_multifield, i ) == INTEGER )
+      return static_cast<double>( ValueToLong( GetMFValue( m_multifield, i ) ) );
+    return ValueToDouble( GetMFValue( m_multifield, i ) );
+  }
+
+  long int MultifieldView::as_integer( std::size_t index ) const
+  {
+    long int i = m_begin + index;
+    if ( GetMFType( m_multifield, i ) == FLOAT )
+      return static_cast<long int>( ValueToDouble( GetMFValue( m_multifield, i ) ) );
+    return ValueToLong( GetMFValue( m_multifield, i ) );
+  }
+
+  const char* MultifieldView::as_string( std::size_t index ) const
+  {
+    return ValueToString( GetMFValue( m_multifield, m_begin + index ) );
+  }
+
+  void* MultifieldView::as_address( std::size_t index ) const
+  {
+    long int i = m_begin + index;
+    if ( GetMFType( m_multifield, i ) == EXTERNAL_ADDRESS )
+      return ValueToExternalAddress( GetMFValue( m_multifield, i ) );
+    return GetMFValue( m_multifield, i );
+  }
+
+  Value MultifieldView::value( std::size_t index ) const
+  {
+    long int i = m_begin + index;
+    switch ( GetMFType( m_multifield, i ) ) {
+      case FLOAT:
+        return Value( ValueToDouble( GetMFValue( m_multifield, i ) ) );
+      case INTEGER:
+        return Value( ValueToLong( GetMFValue( m_multifield, i ) ) );
+      case SYMBOL:
+        return Value( as_string( index ), TYPE_SYMBOL );
+      case STRING:
+        return Value( as_string( index ), TYPE_STRING );
+      case INSTANCE_NAME:
+        return Value( as_string( index ), TYPE_INSTANCE_NAME );
+      case EXTERNAL_ADDRESS:
+        return Value( as_address( index ), TYPE_EXTERNAL_ADDRESS );
+      case FACT_ADDRESS:
+        return Value( as_address( index ), TYPE_FACT_ADDRESS );
+      case INSTANCE_ADDRESS:
+        return Value( as_address( index ), TYPE_INSTANCE_ADDRESS );
+      default:
+        return Value();
+    }
+  }
+
+}
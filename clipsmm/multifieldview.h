@@ -0,0 +1,106 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by the clipsmm developers                          *
+ *                                                                         *
+ *   This file is part of the clipsmm library.                             *
+ *                                                                         *
+ *   The clipsmm library is free software; you can redistribute it and/or  *
+ *   modify it under the terms of the GNU General Public License           *
+ *   version 3 as published by the Free Software Foundation.               *
+ *                                                                         *
+ *   The clipsmm library is distributed in the hope that it will be        *
+ *   useful, but WITHOUT ANY WARRANTY; without even the implied warranty   *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU   *
+ *   General Public License for more details.                              *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this software. If not see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+#ifndef CLIPSMULTIFIELDVIEW_H
+#define CLIPSMULTIFIELDVIEW_H
+
+#include <cstddef>
+
+#include <clipsmm/value.h>
+
+namespace CLIPS {
+
+  /**
+   * Non-owning view of a CLIPS multifield.
+   *
+   * Functions added with Environment::add_function() can take a
+   * MultifieldView argument to access a multifield in place instead of
+   * receiving a copy as Values. The view is only valid for the duration
+   * of the function call. Indices start at zero.
+   */
+  class MultifieldView {
+    public:
+      MultifieldView();
+
+      MultifieldView( void* multifield, long int begin, long int end );
+
+      /** Number of elements in the view */
+      std::size_t size() const { return m_size; }
+
+      /** True if the view has no elements */
+      bool empty() const { return m_size == 0; }
+
+      /** Type of the element at the given index */
+      Type type( std::size_t index ) const;
+
+      /** Element as double, integer elements are converted */
+      double as_float( std::size_t index ) const;
+
+      /** Element as integer, float elements are truncated */
+      long int as_integer( std::size_t index ) const;
+
+      /** Lexeme of a symbol, string or instance name element, points into the symbol table */
+      const char* as_string( std::size_t index ) const;
+
+      /** Pointer of an external, fact or instance address element */
+      void* as_address( std::size_t index ) const;
+
+      /** Copy of the element as Value */
+      Value value( std::size_t index ) const;
+
+      /** Copy of the element as Value */
+      Value operator[]( std::size_t index ) const { return value( index ); }
+
+    protected:
+      void* m_multifield;
+      long int m_begin;
+      std::size_t m_size;
+  };
+
+  /**
+   * Read-only contiguous sequence of doubles.
+   *
+   * Functions added with Environment::add_function() can take a
+   * DoubleSpan argument for numeric multifields. The elements are
+   * converted into a thread local buffer that is reused for each call,
+   * avoiding an allocation per call and per element. The span is only
+   * valid until the function returns and must not be held across calls
+   * into CLIPS that call functions taking a DoubleSpan themselves.
+   */
+  class DoubleSpan {
+    public:
+      DoubleSpan(): m_data(0), m_size(0) { }
+
+      DoubleSpan( const double* data, std::size_t size ): m_data(data), m_size(size) { }
+
+      const double* data() const { return m_data; }
+      std::size_t size() const { return m_size; }
+      bool empty() const { return m_size == 0; }
+
+      const double* begin() const { return m_data; }
+      const double* end() const { return m_data + m_size; }
+
+      const double& operator[]( std::size_t index ) const { return m_data[index]; }
+
+    protected:
+      const double* m_data;
+      std::size_t m_size;
+  };
+
+}
+
+#endif
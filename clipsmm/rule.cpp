@@ -135,10 +135,10 @@ void Rule::set_watch_firings( bool set )
 
 bool Rule::retract( )
 {
-  if ( m_cobj )
-    return EnvUndefrule( m_environment.cobj(), m_cobj );
-  else
+  if ( ! m_cobj || ! EnvUndefrule( m_environment.cobj(), m_cobj ) )
     return false;
+  m_environment.constructs_changed();
+  return true;
 }
 
 }
@@ -175,9 +175,10 @@ namespace CLIPS {
   }
 
   bool Template::retract( ) {
-    if ( !m_cobj )
+    if ( !m_cobj || ! EnvUndeftemplate( m_environment.cobj(), m_cobj ) )
       return false;
-    return EnvUndeftemplate( m_environment.cobj(), m_cobj );
+    m_environment.constructs_changed();
+    return true;
   }
 
 }
@@ -0,0 +1,220 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by the clipsmm developers                          *
+ *                                                                         *
+ *   This file is part of the clipsmm library.                             *
+ *                                                                         *
+ *   The clipsmm library is free software; you can redistribute it and/or  *
+ *   modify it under the terms of the GNU General Public License           *
+ *   version 3 as published by the Free Software Foundation.               *
+ *                                                                         *
+ *   The clipsmm library is distributed in the hope that it will be        *
+ *   useful, but WITHOUT ANY WARRANTY; without even the implied warranty   *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU   *
+ *   General Public License for more details.                              *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this software. If not see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+#ifndef CLIPSUSERFUNCTION_H
+#define CLIPSUSERFUNCTION_H
+
+#include <chrono>
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+
+#include <clipsmm/pointer.h>
+#include <clipsmm/utility.h>
+
+namespace CLIPS {
+
+  /** Compile time sequence of indices, used to unpack argument tuples */
+  template <std::size_t... I>
+  struct IndexSequence { };
+
+  /** Generates IndexSequence<0, ..., N-1> */
+  template <std::size_t N, std::size_t... I>
+  struct MakeIndexSequence : MakeIndexSequence<N - 1, N - 1, I...> { };
+
+  template <std::size_t... I>
+  struct MakeIndexSequence<0, I...> : IndexSequence<I...> { };
+
+  /**
+   * Return and argument types of a callable.
+   * Works for function pointers, and for classes with a single
+   * non-template call operator like lambdas, std::function and sigc::slot.
+   * Argument types are decayed, a callable taking a const std::string&
+   * receives its argument from a std::string.
+   */
+  template <typename T_callable>
+  struct FunctionTraits : FunctionTraits<decltype( &T_callable::operator() )> { };
+
+  template <typename T_return, typename... T_args>
+  struct FunctionTraits<T_return ( * )( T_args... )> {
+    typedef T_return return_type;
+    typedef std::tuple<typename std::decay<T_args>::type...> argument_tuple;
+    static const std::size_t arity = sizeof...( T_args );
+  };
+
+  template <typename T_return, typename... T_args>
+  struct FunctionTraits<T_return( T_args... )> : FunctionTraits<T_return ( * )( T_args... )> { };
+
+  template <typename T_class, typename T_return, typename... T_args>
+  struct FunctionTraits<T_return ( T_class::* )( T_args... )> : FunctionTraits<T_return ( * )( T_args... )> { };
+
+  template <typename T_class, typename T_return, typename... T_args>
+  struct FunctionTraits<T_return ( T_class::* )( T_args... ) const> : FunctionTraits<T_return ( * )( T_args... )> { };
+
+  /**
+   * CLIPS argument restriction string for a function taking T_args.
+   * Generated at compile time from get_argument_code(), e.g. "22uid"
+   * for (int, double). Argument counts are single digits in CLIPS,
+   * functions with more than nine arguments get an open count ("**").
+   */
+  template <typename... T_args>
+  struct FunctionRestriction {
+    static constexpr char value[] = {
+      sizeof...( T_args ) <= 9 ? char( '0' + sizeof...( T_args ) ) : '*',
+      sizeof...( T_args ) <= 9 ? char( '0' + sizeof...( T_args ) ) : '*',
+      'u', get_argument_code<T_args>()..., '\0' };
+  };
+
+  template <typename... T_args>
+  constexpr char FunctionRestriction<T_args...>::value[];
+
+  /** Restriction string of a function taking the elements of a tuple */
+  template <typename T_tuple>
+  struct TupleRestriction;
+
+  template <typename... T_args>
+  struct TupleRestriction<std::tuple<T_args...> > : FunctionRestriction<T_args...> { };
+
+  /** Call statistics of a function added with Environment::add_function() */
+  struct FunctionStats {
+    /** Number of histogram buckets */
+    static const unsigned int NUM_BUCKETS = 32;
+
+    FunctionStats();
+
+    unsigned long int calls; /**< Number of calls */
+    double total_time; /**< Summed time in seconds spent in calls, including argument conversion */
+    double max_time; /**< Maximum time in seconds of a single call */
+
+    /**
+     * Latency histogram with logarithmic buckets. Bucket i counts calls
+     * that took [2^i, 2^(i+1)) nanoseconds, bucket 0 includes calls below
+     * one nanosecond and the last bucket all longer calls.
+     */
+    unsigned long int histogram[NUM_BUCKETS];
+
+    /** Records a call that took the given number of nanoseconds */
+    void record( unsigned long long int nanoseconds );
+  };
+
+  inline FunctionStats::FunctionStats():
+    calls(0), total_time(0.0), max_time(0.0)
+  {
+    for ( unsigned int i = 0; i < NUM_BUCKETS; ++i ) histogram[i] = 0;
+  }
+
+  inline void FunctionStats::record( unsigned long long int nanoseconds )
+  {
+    double seconds = nanoseconds * 1e-9;
+    calls += 1;
+    total_time += seconds;
+    if ( seconds > max_time ) max_time = seconds;
+
+    unsigned int bucket = 0;
+    while ( ( nanoseconds >>= 1 ) != 0 && bucket < NUM_BUCKETS - 1 ) ++bucket;
+    histogram[bucket] += 1;
+  }
+
+  /**
+   * Base class of C++ functions registered with an environment.
+   * Owns the callable, the environment passes a pointer to the concrete
+   * UserFunctionImpl as function context to CLIPS.
+   */
+  class UserFunction {
+    public:
+      typedef CLIPSPointer<UserFunction> pointer;
+
+      /** Signature of the function pointers passed to CLIPS */
+      typedef int ( *Callback )( void* );
+
+      UserFunction(): m_profiling(false), m_return_code('\0'), m_callback(NULL), m_restrictions(NULL) { }
+
+      virtual ~UserFunction() { }
+
+      /** Copies the callable and the registration, but not the statistics */
+      virtual UserFunction* clone() const = 0;
+
+      /** Stores what is passed to CLIPS, so the function can be added to other environments */
+      void set_registration( char return_code, Callback callback, const char* restrictions ) {
+        m_return_code = return_code;
+        m_callback = callback;
+        m_restrictions = restrictions;
+      }
+
+      char return_code() const { return m_return_code; }
+
+      Callback callback() const { return m_callback; }
+
+      const char* restrictions() const { return m_restrictions; }
+
+      /** True if calls are timed and recorded in stats() */
+      bool profiling() const { return m_profiling; }
+
+      void set_profiling( bool enable ) { m_profiling = enable; }
+
+      const FunctionStats& stats() const { return m_stats; }
+
+      void reset_stats() { m_stats = FunctionStats(); }
+
+      /** Times a call while in scope, used by the callback trampolines */
+      class CallTimer {
+        public:
+          CallTimer( UserFunction& function ):
+            m_function(function), m_start(std::chrono::steady_clock::now()) { }
+
+          ~CallTimer() {
+            m_function.m_stats.record( std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                         std::chrono::steady_clock::now() - m_start ).count() );
+          }
+
+        private:
+          UserFunction& m_function;
+          std::chrono::steady_clock::time_point m_start;
+      };
+
+    protected:
+      bool m_profiling;
+      FunctionStats m_stats;
+      char m_return_code;
+      Callback m_callback;
+      const char* m_restrictions;
+  };
+
+  /**
+   * Holds a callable of type T_callable.
+   * The callback trampoline for a function is instantiated for its
+   * callable type and invokes it directly, no type erased wrapper is
+   * involved. Stateless callables like captureless lambdas are empty.
+   */
+  template <typename T_callable>
+  class UserFunctionImpl : public UserFunction {
+    public:
+      UserFunctionImpl( const T_callable& c ): callable( c ) { }
+
+      UserFunction* clone() const {
+        UserFunctionImpl* function = new UserFunctionImpl( callable );
+        function->set_profiling( m_profiling );
+        function->set_registration( m_return_code, m_callback, m_restrictions );
+        return function;
+      }
+
+      T_callable callable;
+  };
+
+}
+
+#endif
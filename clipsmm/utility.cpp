@@ -108,33 +108,54 @@ namespace CLIPS {
     value = EnvRtnLexeme(env, argposition);
   }
 
+  void get_argument(void* env, int argposition, const char*& value) {
+    value = EnvRtnLexeme(env, argposition);
+  }
+
   void get_argument(void* env, int argposition, Values& values) {
     DATA_OBJECT arg;
     if (EnvArgTypeCheck(env, (char *)"clipsmm get_argument",
                         argposition, MULTIFIELD, &arg) == 0)   return;
 
+    MultifieldView view(EnvGetValue(env, arg), EnvGetDOBegin(env, arg), EnvGetDOEnd(env, arg));
     values.clear();
+    values.reserve(view.size());
+    for (std::size_t i = 0; i < view.size(); ++i) {
+      values.push_back(view.value(i));
+    }
+  }
 
-    int end = EnvGetDOEnd(env, arg);
-    void *mfp = EnvGetValue(env, arg);
-    for (int i = EnvGetDOBegin(env, arg); i <= end; ++i) {
-      switch (GetMFType(mfp, i)) {
-      case SYMBOL:
-      case STRING:
-      case INSTANCE_NAME:
-        values.push_back(Value(ValueToString(GetMFValue(mfp, i))));
-        break;
-      case FLOAT:
-        values.push_back(Value(ValueToDouble(GetMFValue(mfp, i))));
-        break;
-      case INTEGER:
-        values.push_back(Value(ValueToInteger(GetMFValue(mfp, i))));
-        break;
-      default:
-        continue;
-        break;
+  void get_argument(void* env, int argposition, MultifieldView& view) {
+    DATA_OBJECT arg;
+    if (EnvArgTypeCheck(env, (char *)"clipsmm get_argument",
+                        argposition, MULTIFIELD, &arg) == 0) {
+      view = MultifieldView();
+      return;
+    }
+    view = MultifieldView(EnvGetValue(env, arg), EnvGetDOBegin(env, arg), EnvGetDOEnd(env, arg));
+  }
+
+  void get_argument(void* env, int argposition, DoubleSpan& span) {
+    // One buffer per argument position, so functions may take several spans
+    static thread_local std::vector<std::vector<double> > buffers;
+
+    span = DoubleSpan();
+    MultifieldView view;
+    get_argument(env, argposition, view);
+
+    if (buffers.size() < (std::size_t)argposition)  buffers.resize(argposition);
+    std::vector<double>& buffer = buffers[argposition - 1];
+    buffer.resize(view.size());
+    for (std::size_t i = 0; i < view.size(); ++i) {
+      Type type = view.type(i);
+      if (type != TYPE_FLOAT && type != TYPE_INTEGER) {
+        EnvPrintRouter(env, WERROR, "clipsmm get_argument: multifield contains non-numeric element\n");
+        EnvSetEvaluationError(env, TRUE);
+        return;
       }
+      buffer[i] = view.as_float(i);
     }
+    span = DoubleSpan(buffer.data(), buffer.size());
   }
 
   void get_argument(void* env, int argposition, Value& value) {
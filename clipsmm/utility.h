@@ -22,8 +22,17 @@
 #include <vector>
 #include <string>
 #include <stdexcept>
+#include <type_traits>
+#if __cplusplus >= 201703L
+#  include <string_view>
+#endif
+#if __cplusplus >= 202002L
+#  include <span>
+#endif
 
+#include <clipsmm/pointer.h>
 #include <clipsmm/value.h>
+#include <clipsmm/multifieldview.h>
 
 extern "C" {
   struct dataObject;
@@ -31,6 +40,9 @@ extern "C" {
 
 namespace CLIPS {
 
+  class Fact;
+  class FactRef;
+
   /** The init method should be called before any other clipsmm functions. */
   void init( );
 
@@ -45,36 +57,93 @@ namespace CLIPS {
   void get_argument(void* env, int argposition, unsigned& value);
   void get_argument(void* env, int argposition, long& value);
   void get_argument(void* env, int argposition, std::string& value);
+  /**
+   * Gets a symbol or string argument without copying it.
+   * The pointer refers to the CLIPS symbol table and stays valid for the
+   * duration of the function call.
+   */
+  void get_argument(void* env, int argposition, const char*& value);
   void get_argument(void* env, int argposition, Values& values);
+  void get_argument(void* env, int argposition, MultifieldView& view);
+  /**
+   * Gets a multifield of numbers as contiguous doubles.
+   * The span refers to a thread local buffer per argument position,
+   * see DoubleSpan.
+   */
+  void get_argument(void* env, int argposition, DoubleSpan& span);
   void get_argument(void* env, int argposition, Value& value);
   void get_argument(void* env, int argposition, void*& value);
+  /** Gets a fact-address argument, defined in fact.cpp */
+  void get_argument(void* env, int argposition, CLIPSPointer<Fact>& value);
+  /** Gets a fact-address argument without allocating, see FactRef */
+  void get_argument(void* env, int argposition, FactRef& value);
+
+#if __cplusplus >= 201703L
+  /**
+   * Gets a symbol or string argument without copying it.
+   * The view refers to the CLIPS symbol table and stays valid for the
+   * duration of the function call.
+   */
+  inline void get_argument(void* env, int argposition, std::string_view& value) {
+    const char* lexeme;
+    get_argument(env, argposition, lexeme);
+    value = lexeme;
+  }
+#endif
 
-  template <typename T_return> inline char get_return_code() {
-    throw std::logic_error("clipsmm: Adding function with invalid return type");
+#if __cplusplus >= 202002L
+  /** Gets a multifield of numbers as contiguous doubles, see DoubleSpan */
+  inline void get_argument(void* env, int argposition, std::span<const double>& value) {
+    DoubleSpan span;
+    get_argument(env, argposition, span);
+    value = std::span<const double>(span.data(), span.size());
   }
-  template <> inline char get_return_code<void *>()      { return 'a'; }
-  template <> inline char get_return_code<bool>()        { return 'b'; }
-  template <> inline char get_return_code<char>()        { return 'c'; }
-  template <> inline char get_return_code<double>()      { return 'd'; }
-  template <> inline char get_return_code<float>()       { return 'f'; }
-  template <> inline char get_return_code<int>()         { return 'i'; }
-  template <> inline char get_return_code<long>()        { return 'l'; }
-  template <> inline char get_return_code<std::string>() { return 's'; }
-  template <> inline char get_return_code<void>()        { return 'v'; }
-  template <> inline char get_return_code<Values>()      { return 'm'; }
-  template <> inline char get_return_code<Value>()       { return 'u'; }
+#endif
+
+  /** Always false, delays static assertions until template instantiation */
+  template <typename T> struct DependentFalse : std::false_type { };
+
+  template <typename T_return> inline constexpr char get_return_code() {
+    static_assert( DependentFalse<T_return>::value, "clipsmm: Adding function with invalid return type" );
+    return '\0';
+  }
+  template <> inline constexpr char get_return_code<void *>()      { return 'a'; }
+  template <> inline constexpr char get_return_code<bool>()        { return 'b'; }
+  template <> inline constexpr char get_return_code<char>()        { return 'c'; }
+  template <> inline constexpr char get_return_code<double>()      { return 'd'; }
+  template <> inline constexpr char get_return_code<float>()       { return 'f'; }
+  template <> inline constexpr char get_return_code<int>()         { return 'i'; }
+  template <> inline constexpr char get_return_code<long>()        { return 'l'; }
+  template <> inline constexpr char get_return_code<std::string>() { return 's'; }
+  template <> inline constexpr char get_return_code<void>()        { return 'v'; }
+  template <> inline constexpr char get_return_code<Values>()      { return 'm'; }
+  template <> inline constexpr char get_return_code<Value>()       { return 'u'; }
+  template <> inline constexpr char get_return_code<CLIPSPointer<Fact> >() { return 'u'; }
+  template <> inline constexpr char get_return_code<FactRef>()     { return 'u'; }
 
-  template <typename T_return> inline char get_argument_code() {
-    throw std::logic_error("clipsmm: Adding function with invalid argument type");
+  template <typename T_return> inline constexpr char get_argument_code() {
+    static_assert( DependentFalse<T_return>::value, "clipsmm: Adding function with invalid argument type" );
+    return '\0';
   }
-  template <> inline char get_argument_code<void *>()      { return 'a'; }
-  template <> inline char get_argument_code<double>()      { return 'd'; }
-  template <> inline char get_argument_code<float>()       { return 'f'; }
-  template <> inline char get_argument_code<int>()         { return 'i'; }
-  template <> inline char get_argument_code<long>()        { return 'l'; }
-  template <> inline char get_argument_code<std::string>() { return 's'; }
-  template <> inline char get_argument_code<Values>()      { return 'm'; }
-  template <> inline char get_argument_code<Value>()       { return 'u'; }
+  template <> inline constexpr char get_argument_code<void *>()      { return 'a'; }
+  template <> inline constexpr char get_argument_code<double>()      { return 'd'; }
+  template <> inline constexpr char get_argument_code<float>()       { return 'f'; }
+  template <> inline constexpr char get_argument_code<int>()         { return 'i'; }
+  template <> inline constexpr char get_argument_code<long>()        { return 'l'; }
+  template <> inline constexpr char get_argument_code<std::string>() { return 's'; }
+  template <> inline constexpr char get_argument_code<const char *>() { return 'k'; }
+#if __cplusplus >= 201703L
+  template <> inline constexpr char get_argument_code<std::string_view>() { return 'k'; }
+#endif
+  template <> inline constexpr char get_argument_code<Values>()      { return 'm'; }
+  template <> inline constexpr char get_argument_code<MultifieldView>() { return 'm'; }
+  template <> inline constexpr char get_argument_code<DoubleSpan>()  { return 'm'; }
+#if __cplusplus >= 202002L
+  template <> inline constexpr char get_argument_code<std::span<const double> >() { return 'm'; }
+#endif
+  template <> inline constexpr char get_argument_code<Value>()       { return 'u'; }
+  template <> inline constexpr char get_argument_code<CLIPSPointer<Fact> >() { return 'y'; }
+  template <> inline constexpr char get_argument_code<FactRef>()     { return 'y'; }
 
 }
 
@@ -128,6 +128,7 @@ namespace CLIPS {
 
       void* Value::as_address() const {
         switch ( m_clips_type ) {
+          case TYPE_FACT_ADDRESS:
           case TYPE_EXTERNAL_ADDRESS:
             return m_value;
           case TYPE_INSTANCE_ADDRESS:
@@ -206,9 +207,10 @@ namespace CLIPS {
         if ( change_type )
           this->set_type( type );
         if ( ! ( m_clips_type == TYPE_EXTERNAL_ADDRESS ||
+                 m_clips_type == TYPE_FACT_ADDRESS ||
                  m_clips_type == TYPE_INSTANCE_ADDRESS ) )
           throw std::logic_error("Invalid set( void* x ) on non-address value");
-	if (m_clips_type == TYPE_EXTERNAL_ADDRESS) {
+	if (m_clips_type == TYPE_EXTERNAL_ADDRESS || m_clips_type == TYPE_FACT_ADDRESS) {
 	  m_value = x;
 	} else {
           *static_cast<int**>(m_value) = static_cast<int*>(x);
@@ -271,6 +273,7 @@ namespace CLIPS {
           case TYPE_STRING:
           case TYPE_INSTANCE_NAME:
             return sizeof( *static_cast<std::string*>(m_value) );
+          case TYPE_FACT_ADDRESS:
           case TYPE_EXTERNAL_ADDRESS:
             return sizeof(void*);
 
@@ -339,8 +342,10 @@ namespace CLIPS {
           case TYPE_INSTANCE_NAME:
             *static_cast<std::string*>(m_value) = *static_cast<std::string*>(x.m_value);
             break;
+          case TYPE_FACT_ADDRESS:
           case TYPE_EXTERNAL_ADDRESS:
 	    m_value = x.m_value;
+	    break;
 
           case TYPE_INSTANCE_ADDRESS:
             *static_cast<int**>(m_value) = *static_cast<int**>(x.m_value);
@@ -458,6 +463,7 @@ namespace CLIPS {
           case TYPE_INSTANCE_NAME:
             m_value = new std::string;
             break;
+          case TYPE_FACT_ADDRESS:
           case TYPE_EXTERNAL_ADDRESS:
 	    m_value = NULL;
 	    break;
@@ -487,6 +493,7 @@ namespace CLIPS {
           case TYPE_INSTANCE_NAME:
             delete static_cast<std::string*>(m_value);
             break;
+          case TYPE_FACT_ADDRESS:
           case TYPE_EXTERNAL_ADDRESS:
 	    m_value = NULL;
 	    break;
@@ -33,6 +33,7 @@ typedef enum Type {
   TYPE_SYMBOL = 2,
   TYPE_STRING = 3,
   TYPE_EXTERNAL_ADDRESS = 5,
+  TYPE_FACT_ADDRESS = 6,
   TYPE_INSTANCE_ADDRESS = 7,
   TYPE_INSTANCE_NAME = 8,
 } Type;
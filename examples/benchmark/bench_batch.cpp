@@ -0,0 +1,85 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by the clipsmm developers                          *
+ *                                                                         *
+ *   This file is part of the clipsmm library.                             *
+ *                                                                         *
+ *   The clipsmm library is free software; you can redistribute it and/or  *
+ *   modify it under the terms of the GNU General Public License           *
+ *   version 3 as published by the Free Software Foundation.               *
+ *                                                                         *
+ *   The clipsmm library is distributed in the hope that it will be        *
+ *   useful, but WITHOUT ANY WARRANTY; without even the implied warranty   *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU   *
+ *   General Public License for more details.                              *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this software. If not see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+/*
+ * Compares a dashboard style refresh of many computed values with
+ * Environment::evaluate() in a loop against evaluate_batch() on
+ * expression strings and on prepared expressions.
+ */
+
+#include <clipsmm.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+
+int main( int argc, char** argv )
+{
+  CLIPS::init();
+
+  long int refreshes = ( argc > 1 ) ? atol( argv[1] ) : 1000;
+  const unsigned int num_expressions = 200;
+
+  CLIPS::Environment env;
+  env.build( "(defglobal ?*load* = 17)" );
+
+  std::vector<std::string> expressions;
+  std::vector<CLIPS::Expression::pointer> prepared;
+  for ( unsigned int i = 0; i < num_expressions; ++i ) {
+    std::ostringstream expression;
+    expression << "(+ (* ?*load* " << i << ") " << i << ")";
+    expressions.push_back( expression.str() );
+    prepared.push_back( env.prepare( expression.str() ) );
+  }
+
+  Glib::Timer timer;
+  long int sum = 0;
+
+  timer.start();
+  for ( long int r = 0; r < refreshes; ++r )
+    for ( unsigned int i = 0; i < num_expressions; ++i )
+      sum += env.evaluate( expressions[i] )[0].as_integer();
+  timer.stop();
+  double single = timer.elapsed();
+  printf( "evaluate() loop:           %.1f us/refresh\n", single * 1e6 / refreshes );
+
+  std::vector<CLIPS::Environment::EvaluationResult> results;
+  timer.start();
+  for ( long int r = 0; r < refreshes; ++r ) {
+    env.evaluate_batch( expressions, results );
+    for ( unsigned int i = 0; i < num_expressions; ++i )
+      sum -= results[i].values[0].as_integer();
+  }
+  timer.stop();
+  double batch = timer.elapsed();
+  printf( "evaluate_batch( strings ): %.1f us/refresh\n", batch * 1e6 / refreshes );
+
+  timer.start();
+  for ( long int r = 0; r < refreshes; ++r ) {
+    env.evaluate_batch( prepared, results );
+    for ( unsigned int i = 0; i < num_expressions; ++i )
+      sum += results[i].values[0].as_integer();
+  }
+  timer.stop();
+  double batch_prepared = timer.elapsed();
+  printf( "evaluate_batch( prepared ): %.1f us/refresh\n", batch_prepared * 1e6 / refreshes );
+
+  printf( "speedup of prepared batch over evaluate() loop: %.2fx (checksum %ld)\n",
+          single / batch_prepared, sum );
+
+  return 0;
+}
@@ -0,0 +1,74 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by the clipsmm developers                          *
+ *                                                                         *
+ *   This file is part of the clipsmm library.                             *
+ *                                                                         *
+ *   The clipsmm library is free software; you can redistribute it and/or  *
+ *   modify it under the terms of the GNU General Public License           *
+ *   version 3 as published by the Free Software Foundation.               *
+ *                                                                         *
+ *   The clipsmm library is distributed in the hope that it will be        *
+ *   useful, but WITHOUT ANY WARRANTY; without even the implied warranty   *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU   *
+ *   General Public License for more details.                              *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this software. If not see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+/*
+ * Compares Environment::function(), which formats and parses an
+ * argument string, with Environment::call(), which builds the call
+ * expression directly from typed arguments.
+ */
+
+#include <clipsmm.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+
+int main( int argc, char** argv )
+{
+  CLIPS::init();
+
+  long int calls = ( argc > 1 ) ? atol( argv[1] ) : 200000;
+
+  CLIPS::Environment env;
+  env.build( "(deffunction scale (?x ?f) (* ?x ?f))" );
+
+  Glib::Timer timer;
+  long int sum = 0;
+
+  timer.start();
+  for ( long int i = 0; i < calls; ++i ) {
+    std::ostringstream args;
+    args << i << " 3";
+    sum += env.function( "scale", args.str() )[0].as_integer();
+  }
+  timer.stop();
+  double formatted = timer.elapsed();
+  printf( "function():         %.1f ns/call\n", formatted * 1e9 / calls );
+
+  CLIPS::Values args( 2 );
+  timer.start();
+  for ( long int i = 0; i < calls; ++i ) {
+    args[0] = CLIPS::Value( i );
+    args[1] = CLIPS::Value( 3l );
+    sum -= env.call( "scale", args )[0].as_integer();
+  }
+  timer.stop();
+  double values = timer.elapsed();
+  printf( "call( Values ):     %.1f ns/call\n", values * 1e9 / calls );
+
+  timer.start();
+  for ( long int i = 0; i < calls; ++i )
+    sum += env.call( "scale", i, 3l )[0].as_integer();
+  timer.stop();
+  double typed = timer.elapsed();
+  printf( "call( args... ):    %.1f ns/call\n", typed * 1e9 / calls );
+
+  printf( "speedup of typed call over function(): %.2fx (checksum %ld)\n",
+          formatted / typed, sum );
+
+  return 0;
+}
@@ -0,0 +1,103 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by the clipsmm developers                          *
+ *                                                                         *
+ *   This file is part of the clipsmm library.                             *
+ *                                                                         *
+ *   The clipsmm library is free software; you can redistribute it and/or  *
+ *   modify it under the terms of the GNU General Public License           *
+ *   version 3 as published by the Free Software Foundation.               *
+ *                                                                         *
+ *   The clipsmm library is distributed in the hope that it will be        *
+ *   useful, but WITHOUT ANY WARRANTY; without even the implied warranty   *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU   *
+ *   General Public License for more details.                              *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this software. If not see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+/*
+ * Compares saving and restoring working memory with the save-facts and
+ * load-facts commands against Environment::checkpoint() and restore().
+ */
+
+#include <clipsmm.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static long int file_size( const char* path )
+{
+  struct stat st;
+  return ( stat( path, &st ) == 0 ) ? st.st_size : -1;
+}
+
+static void setup( CLIPS::Environment& env )
+{
+  env.build( "(deftemplate reading (slot sensor) (slot value) (multislot history))" );
+  env.build( "(defglobal ?*last* = 0)" );
+}
+
+int main( int argc, char** argv )
+{
+  CLIPS::init();
+
+  long int num_facts = ( argc > 1 ) ? atol( argv[1] ) : 20000;
+  long int rounds = ( argc > 2 ) ? atol( argv[2] ) : 5;
+  const char* text_path = "bench_checkpoint.facts";
+  const char* binary_path = "bench_checkpoint.bin";
+
+  CLIPS::Environment source;
+  setup( source );
+  for ( long int i = 0; i < num_facts; ++i ) {
+    std::ostringstream fact;
+    fact << "(reading (sensor \"sensor-" << i % 100 << "\") (value " << i * 0.5
+         << ") (history " << i << " " << i + 1 << " ok))";
+    source.assert_fact( fact.str() );
+  }
+
+  Glib::Timer timer;
+  timer.start();
+  for ( long int r = 0; r < rounds; ++r )
+    source.evaluate( std::string( "(save-facts \"" ) + text_path + "\")" );
+  timer.stop();
+  double text_save = timer.elapsed() / rounds;
+
+  timer.start();
+  for ( long int r = 0; r < rounds; ++r )
+    source.checkpoint( binary_path );
+  timer.stop();
+  double binary_save = timer.elapsed() / rounds;
+
+  double text_load = 0, binary_load = 0;
+  for ( long int r = 0; r < rounds; ++r ) {
+    CLIPS::Environment text_target, binary_target;
+    setup( text_target );
+    setup( binary_target );
+
+    timer.start();
+    text_target.evaluate( std::string( "(load-facts \"" ) + text_path + "\")" );
+    timer.stop();
+    text_load += timer.elapsed();
+
+    timer.start();
+    binary_target.restore( binary_path );
+    timer.stop();
+    binary_load += timer.elapsed();
+  }
+  text_load /= rounds;
+  binary_load /= rounds;
+
+  printf( "%ld facts\n", num_facts );
+  printf( "save-facts/load-facts: %8ld bytes, save %.2f ms, load %.2f ms\n",
+          file_size( text_path ), text_save * 1e3, text_load * 1e3 );
+  printf( "checkpoint/restore:    %8ld bytes, save %.2f ms, load %.2f ms\n",
+          file_size( binary_path ), binary_save * 1e3, binary_load * 1e3 );
+  printf( "speedup: save %.2fx, load %.2fx\n", text_save / binary_save, text_load / binary_load );
+
+  unlink( text_path );
+  unlink( binary_path );
+  return 0;
+}
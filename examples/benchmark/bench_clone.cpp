@@ -0,0 +1,89 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by the clipsmm developers                          *
+ *                                                                         *
+ *   This file is part of the clipsmm library.                             *
+ *                                                                         *
+ *   The clipsmm library is free software; you can redistribute it and/or  *
+ *   modify it under the terms of the GNU General Public License           *
+ *   version 3 as published by the Free Software Foundation.               *
+ *                                                                         *
+ *   The clipsmm library is distributed in the hope that it will be        *
+ *   useful, but WITHOUT ANY WARRANTY; without even the implied warranty   *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU   *
+ *   General Public License for more details.                              *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this software. If not see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+/*
+ * Compares setting up a tenant environment from scratch, by building
+ * constructs and adding functions, with Environment::clone() of a
+ * prepared template environment.
+ */
+
+#include <clipsmm.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+
+static long int scale( long int x ) { return x * 3; }
+
+static void setup( CLIPS::Environment& env, unsigned int num_rules )
+{
+  env.add_function( "scale", &scale );
+  for ( unsigned int i = 0; i < num_rules; ++i ) {
+    std::ostringstream construct;
+    construct << "(deftemplate reading" << i << " (slot sensor) (slot value))";
+    env.build( construct.str() );
+    construct.str( "" );
+    construct << "(defrule check" << i << " (reading" << i << " (sensor ?s) (value ?v&:(> (scale ?v) 100)))"
+              << " => (assert (alarm ?s " << i << ")))";
+    env.build( construct.str() );
+  }
+}
+
+int main( int argc, char** argv )
+{
+  CLIPS::init();
+
+  unsigned int num_rules = ( argc > 1 ) ? atoi( argv[1] ) : 200;
+  long int rounds = ( argc > 2 ) ? atol( argv[2] ) : 200;
+
+  Glib::Timer timer;
+  timer.start();
+  for ( long int r = 0; r < rounds; ++r ) {
+    CLIPS::Environment env;
+    setup( env, num_rules );
+  }
+  timer.stop();
+  double scratch = timer.elapsed();
+  printf( "build from scratch: %.1f us/environment\n", scratch * 1e6 / rounds );
+
+  CLIPS::Environment prepared;
+  setup( prepared, num_rules );
+  prepared.clone();
+
+  timer.start();
+  for ( long int r = 0; r < rounds; ++r )
+    prepared.clone();
+  timer.stop();
+  double cloned = timer.elapsed();
+  printf( "clone():            %.1f us/environment\n", cloned * 1e6 / rounds );
+
+  for ( unsigned int i = 0; i < num_rules; ++i ) {
+    std::ostringstream fact;
+    fact << "(reading" << i << " (sensor s" << i << ") (value " << i << "))";
+    prepared.assert_fact( fact.str() );
+  }
+  timer.start();
+  for ( long int r = 0; r < rounds; ++r )
+    prepared.clone( true );
+  timer.stop();
+  double with_facts = timer.elapsed();
+  printf( "clone( true ):      %.1f us/environment (%u facts)\n", with_facts * 1e6 / rounds, num_rules );
+
+  printf( "speedup of clone() over building: %.2fx\n", scratch / cloned );
+
+  return 0;
+}
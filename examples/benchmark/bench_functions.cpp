@@ -0,0 +1,78 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by the clipsmm developers                          *
+ *                                                                         *
+ *   This file is part of the clipsmm library.                             *
+ *                                                                         *
+ *   The clipsmm library is free software; you can redistribute it and/or  *
+ *   modify it under the terms of the GNU General Public License           *
+ *   version 3 as published by the Free Software Foundation.               *
+ *                                                                         *
+ *   The clipsmm library is distributed in the hope that it will be        *
+ *   useful, but WITHOUT ANY WARRANTY; without even the implied warranty   *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU   *
+ *   General Public License for more details.                              *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this software. If not see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+/*
+ * Measures the overhead of calling C++ functions from CLIPS.
+ *
+ * The same function adding two integers is registered as a sigc::slot,
+ * as a plain function pointer and as a captureless lambda, and called
+ * from a CLIPS loop. The loop calling the builtin + function serves as
+ * baseline, its time is subtracted to get the per call overhead.
+ * Finally the lambda is timed again with call profiling enabled.
+ */
+
+#include <clipsmm.h>
+
+#include <cstdio>
+#include <cstdlib>
+
+static long int add( long int a, long int b ) { return a + b; }
+
+static double time_loop( CLIPS::Environment& env, const char* function, long int calls )
+{
+  char loop[128];
+  snprintf( loop, sizeof(loop), "(loop-for-count (?i 1 %ld) (%s ?i 1))", calls, function );
+
+  Glib::Timer timer;
+  timer.start();
+  env.evaluate( loop );
+  timer.stop();
+  return timer.elapsed();
+}
+
+int main( int argc, char** argv )
+{
+  CLIPS::init();
+
+  long int calls = ( argc > 1 ) ? atol( argv[1] ) : 1000000;
+
+  CLIPS::Environment env;
+  env.add_function( "add-slot", sigc::slot2<long int, long int, long int>( sigc::ptr_fun( &add ) ) );
+  env.add_function( "add-fptr", &add );
+  env.add_function( "add-lambda", []( long int a, long int b ) { return a + b; } );
+
+  double baseline = time_loop( env, "+", calls );
+  printf( "builtin +:        %.1f ns/call\n", baseline * 1e9 / calls );
+
+  const char* functions[] = { "add-slot", "add-fptr", "add-lambda" };
+  for ( unsigned int i = 0; i < sizeof(functions) / sizeof(functions[0]); ++i ) {
+    double elapsed = time_loop( env, functions[i], calls );
+    printf( "%-16s  %.1f ns/call, %.1f ns/call over builtin\n", functions[i],
+            elapsed * 1e9 / calls, ( elapsed - baseline ) * 1e9 / calls );
+  }
+
+  env.enable_function_profiling();
+  double profiled = time_loop( env, "add-lambda", calls );
+  printf( "%-16s  %.1f ns/call, %.1f ns/call over builtin\n", "add-lambda (prof)",
+          profiled * 1e9 / calls, ( profiled - baseline ) * 1e9 / calls );
+
+  CLIPS::FunctionStats stats = env.function_stats()["add-lambda"];
+  printf( "profiled calls: %lu, mean %.1f ns, max %.1f ns\n", stats.calls,
+          stats.total_time * 1e9 / stats.calls, stats.max_time * 1e9 );
+
+  return 0;
+}
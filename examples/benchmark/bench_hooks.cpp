@@ -0,0 +1,81 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by the clipsmm developers                          *
+ *                                                                         *
+ *   This file is part of the clipsmm library.                             *
+ *                                                                         *
+ *   The clipsmm library is free software; you can redistribute it and/or  *
+ *   modify it under the terms of the GNU General Public License           *
+ *   version 3 as published by the Free Software Foundation.               *
+ *                                                                         *
+ *   The clipsmm library is distributed in the hope that it will be        *
+ *   useful, but WITHOUT ANY WARRANTY; without even the implied warranty   *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU   *
+ *   General Public License for more details.                              *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this software. If not see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+
+/*
+ * Measures the per-firing overhead of the rule firing hook.
+ *
+ * A single rule counts a fact up to a limit, so every firing modifies
+ * one fact. The rule base is run once without any slot connected to
+ * signal_rule_firing() (hook not installed) and once with an empty slot
+ * connected (hook installed, one C to C++ hop and signal emission per
+ * firing).
+ */
+
+#include <clipsmm.h>
+
+#include <cstdio>
+#include <cstdlib>
+
+static void on_rule_firing() { }
+
+static double run_counter( CLIPS::Environment& env, long int firings, long int& executed )
+{
+  char limit[64];
+  snprintf( limit, sizeof(limit), "(bind ?*limit* %ld)", firings );
+
+  env.reset();
+  env.evaluate( limit );
+
+  Glib::Timer timer;
+  timer.start();
+  executed = env.run( -1 );
+  timer.stop();
+  return timer.elapsed();
+}
+
+int main( int argc, char** argv )
+{
+  CLIPS::init();
+
+  long int firings = ( argc > 1 ) ? atol( argv[1] ) : 1000000;
+
+  CLIPS::Environment env;
+  env.build( "(defglobal ?*limit* = 0)" );
+  env.build( "(deftemplate counter (slot value (type INTEGER)))" );
+  env.build( "(deffacts counter-init (counter (value 0)))" );
+  env.build( "(defrule count"
+             "  ?c <- (counter (value ?v&:(< ?v ?*limit*)))"
+             "  =>"
+             "  (modify ?c (value (+ ?v 1))))" );
+
+  long int executed;
+  double unhooked = run_counter( env, firings, executed );
+  printf( "no subscriber:   %ld firings in %.3f s, %.1f ns/firing\n",
+          executed, unhooked, unhooked * 1e9 / executed );
+
+  sigc::connection conn = env.signal_rule_firing().connect( sigc::ptr_fun( &on_rule_firing ) );
+  double hooked = run_counter( env, firings, executed );
+  printf( "one subscriber:  %ld firings in %.3f s, %.1f ns/firing\n",
+          executed, hooked, hooked * 1e9 / executed );
+  conn.disconnect();
+
+  printf( "saved per firing without subscriber: %.1f ns\n",
+          ( hooked - unhooked ) * 1e9 / executed );
+
+  return 0;
+}
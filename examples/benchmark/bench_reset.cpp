@@ -0,0 +1,89 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by the clipsmm developers                          *
+ *                                                                         *
+ *   This file is part of the clipsmm library.                             *
+ *                                                                         *
+ *   The clipsmm library is free software; you can redistribute it and/or  *
+ *   modify it under the terms of the GNU General Public License           *
+ *   version 3 as published by the Free Software Foundation.               *
+ *                                                                         *
+ *   The clipsmm library is distributed in the hope that it will be        *
+ *   useful, but WITHOUT ANY WARRANTY; without even the implied warranty   *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU   *
+ *   General Public License for more details.                              *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this software. If not see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+/*
+ * Compares reset() with fast_reset() between simulated requests on a rule
+ * base with large deffacts. Each request asserts a few facts, runs the
+ * rules and retracts one of the deffacts facts.
+ */
+
+#include <clipsmm.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+
+static void setup( CLIPS::Environment& env, long int num_facts )
+{
+  std::ostringstream deffacts;
+  deffacts << "(deffacts catalog";
+  for ( long int i = 0; i < num_facts; ++i )
+    deffacts << " (item (id " << i << ") (price " << i % 97 << "))";
+  deffacts << ")";
+  env.build( "(deftemplate item (slot id) (slot price))" );
+  env.build( "(deftemplate order (slot id) (slot quantity))" );
+  env.build( deffacts.str() );
+  env.build( "(defrule cheap (item (id ?i) (price ?p&:(< ?p 5))) => )" );
+  env.build( "(defrule total (order (id ?i) (quantity ?q)) (item (id ?i) (price ?p)) =>"
+             " (assert (line ?i (* ?q ?p))))" );
+}
+
+static void request( CLIPS::Environment& env, long int r )
+{
+  std::ostringstream order;
+  order << "(order (id " << r % 50 << ") (quantity 3))";
+  env.assert_fact( order.str() );
+  env.run();
+  env.evaluate( "(retract (nth$ 1 (find-fact ((?f item)) TRUE)))" );
+}
+
+int main( int argc, char** argv )
+{
+  CLIPS::init();
+
+  long int num_facts = ( argc > 1 ) ? atol( argv[1] ) : 5000;
+  long int rounds = ( argc > 2 ) ? atol( argv[2] ) : 200;
+
+  CLIPS::Environment plain, fast;
+  setup( plain, num_facts );
+  setup( fast, num_facts );
+  plain.reset();
+  fast.fast_reset();
+
+  Glib::Timer timer;
+  double plain_reset = 0, fast_reset = 0;
+  for ( long int r = 0; r < rounds; ++r ) {
+    request( plain, r );
+    timer.start();
+    plain.reset();
+    timer.stop();
+    plain_reset += timer.elapsed();
+
+    request( fast, r );
+    timer.start();
+    fast.fast_reset();
+    timer.stop();
+    fast_reset += timer.elapsed();
+  }
+
+  printf( "%ld deffacts facts\n", num_facts );
+  printf( "reset():      %.1f us/request\n", plain_reset * 1e6 / rounds );
+  printf( "fast_reset(): %.1f us/request\n", fast_reset * 1e6 / rounds );
+  printf( "speedup: %.2fx\n", plain_reset / fast_reset );
+
+  return 0;
+}
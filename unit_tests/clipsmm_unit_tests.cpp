@@ -29,10 +29,14 @@
 #include "fact_tests.h"
 #include "value_tests.h"
 #include "function_tests.h"
+#include "environment_tests.h"
+#include "environmentgroup_tests.h"
 
 CPPUNIT_TEST_SUITE_REGISTRATION( ValueTest );
 CPPUNIT_TEST_SUITE_REGISTRATION( FactsTest );
 CPPUNIT_TEST_SUITE_REGISTRATION( FunctionTest );
+CPPUNIT_TEST_SUITE_REGISTRATION( EnvironmentTest );
+CPPUNIT_TEST_SUITE_REGISTRATION( EnvironmentGroupTest );
 
 int main() {
   CLIPS::init();
@@ -0,0 +1,515 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by the clipsmm developers                          *
+ *                                                                         *
+ *   This file is part of the clipsmm library.                             *
+ *                                                                         *
+ *   The clipsmm library is free software; you can redistribute it and/or  *
+ *   modify it under the terms of the GNU General Public License           *
+ *   version 3 as published by the Free Software Foundation.               *
+ *                                                                         *
+ *   The clipsmm library is distributed in the hope that it will be        *
+ *   useful, but WITHOUT ANY WARRANTY; without even the implied warranty   *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU   *
+ *   General Public License for more details.                              *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this software. If not see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+#ifndef ENVIRONMENTTEST_H
+#define ENVIRONMENTTEST_H
+
+#include <cppunit/TestFixture.h>
+
+#include <clipsmm.h>
+
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <cstdlib>
+#include <unistd.h>
+#include <poll.h>
+
+using namespace CLIPS;
+
+std::vector<std::string> visited_constructs;
+
+void visit_construct(const char* module, const char* name) {
+  visited_constructs.push_back(std::string(module) + "::" + name);
+}
+
+int rule_firings = 0;
+
+void count_rule_firing() { ++rule_firings; }
+
+/** Exposes which CLIPS callbacks are installed */
+class CallbackEnvironment : public Environment {
+  public:
+    bool periodic_installed() const { return m_periodic_callback_installed; }
+    bool rule_firing_installed() const { return m_rule_firing_callback_installed; }
+};
+
+class EnvironmentTest : public  CppUnit::TestFixture {
+  public:
+
+  CPPUNIT_TEST_SUITE( EnvironmentTest );
+  CPPUNIT_TEST( callback_installation_test );
+  CPPUNIT_TEST( load_cached_test );
+  CPPUNIT_TEST( load_from_memory_test );
+  CPPUNIT_TEST( clone_test );
+  CPPUNIT_TEST( checkpoint_test );
+  CPPUNIT_TEST( large_checkpoint_test );
+  CPPUNIT_TEST( fast_reset_test );
+  CPPUNIT_TEST( reload_changed_test );
+  CPPUNIT_TEST( environment_manager_test );
+  CPPUNIT_TEST( eviction_refraction_test );
+  CPPUNIT_TEST( construct_names_test );
+  CPPUNIT_TEST( construct_handles_test );
+  CPPUNIT_TEST( agenda_snapshot_test );
+  CPPUNIT_TEST( preemption_test );
+  CPPUNIT_TEST( coalescing_test );
+  CPPUNIT_TEST( completion_notification_test );
+  CPPUNIT_TEST_SUITE_END();
+
+  protected:
+    CLIPS::Environment environment;
+
+  public:
+    void setUp() {
+      environment.clear();
+    }
+
+    void tearDown() { }
+
+  void callback_installation_test() {
+    CallbackEnvironment env;
+    CPPUNIT_ASSERT( env.build( "(defrule step ?f <- (step ?n&:(< ?n 3)) => (retract ?f) (assert (step (+ ?n 1))))" ) );
+    CPPUNIT_ASSERT( ! env.rule_firing_installed() && ! env.periodic_installed() );
+
+    rule_firings = 0;
+    sigc::connection connection = env.signal_rule_firing().connect( sigc::ptr_fun( &count_rule_firing ) );
+    env.assert_fact( "(step 0)" );
+    CPPUNIT_ASSERT( env.run() == 3 );
+    CPPUNIT_ASSERT( env.rule_firing_installed() && ! env.periodic_installed() );
+    CPPUNIT_ASSERT( rule_firings == 3 );
+
+    connection.disconnect();
+    env.assert_fact( "(step 1)" );
+    CPPUNIT_ASSERT( env.run() == 2 );
+    CPPUNIT_ASSERT( ! env.rule_firing_installed() );
+    CPPUNIT_ASSERT( rule_firings == 3 );
+  }
+
+  void load_cached_test() {
+    char cache_dir[] = "/tmp/clipsmm-cache-XXXXXX";
+    CPPUNIT_ASSERT( mkdtemp( cache_dir ) != NULL );
+    std::vector<std::string> files( 1, "strips.clp" );
+
+    Environment cold;
+    CPPUNIT_ASSERT( cold.load_cached( files, cache_dir ) == 1 );
+    CPPUNIT_ASSERT( cold.load_cache_stats().misses == 1 );
+    CPPUNIT_ASSERT( cold.load_cache_stats().hits == 0 );
+
+    Environment warm;
+    CPPUNIT_ASSERT( warm.load_cached( files, cache_dir ) == 1 );
+    CPPUNIT_ASSERT( warm.load_cache_stats().hits == 1 );
+    CPPUNIT_ASSERT( warm.get_template( "in" ) );
+
+    files.push_back( "no-such-file.clp" );
+    CPPUNIT_ASSERT( warm.load_cached( files, cache_dir ) == 0 );
+  }
+
+  void load_from_memory_test() {
+    std::string source = "(deftemplate point (slot x) (slot y))";
+    Environment env;
+    CPPUNIT_ASSERT( env.load_from_memory( source.data(), source.size() ) == 1 );
+    CPPUNIT_ASSERT( env.get_template( "point" ) );
+    CPPUNIT_ASSERT( env.load_from_memory( "(deftemplate", 12 ) == -1 );
+
+    char image_path[] = "/tmp/clipsmm-image-XXXXXX";
+    int fd = mkstemp( image_path );
+    CPPUNIT_ASSERT( fd != -1 );
+    close( fd );
+    CPPUNIT_ASSERT( env.binary_save( image_path ) );
+
+    std::ifstream file( image_path, std::ios::in | std::ios::binary );
+    std::string image( ( std::istreambuf_iterator<char>( file ) ), std::istreambuf_iterator<char>() );
+    Environment from_image;
+    CPPUNIT_ASSERT( from_image.load_from_memory( image.data(), image.size() ) == 1 );
+    CPPUNIT_ASSERT( from_image.get_template( "point" ) );
+
+    Environment mapped;
+    CPPUNIT_ASSERT( mapped.load_mapped( image_path ) == 1 );
+    CPPUNIT_ASSERT( mapped.get_template( "point" ) );
+    CPPUNIT_ASSERT( mapped.load_mapped( "no-such-file.clp" ) == 0 );
+    unlink( image_path );
+
+    Environment mapped_source;
+    CPPUNIT_ASSERT( mapped_source.load_mapped( "strips.clp" ) == 1 );
+    CPPUNIT_ASSERT( mapped_source.get_template( "in" ) );
+  }
+
+  void clone_test() {
+    environment.add_function( "clone-double", []( long x ) { return x * 2; } );
+    CPPUNIT_ASSERT( environment.build( "(deftemplate item (slot n) (multislot tags))" ) );
+    CPPUNIT_ASSERT( environment.build( "(defglobal ?*count* = 5)" ) );
+    CPPUNIT_ASSERT( environment.build( "(deffunction twice (?x) (clone-double ?x))" ) );
+    environment.evaluate( "(bind ?*count* 7)" );
+    environment.assert_fact( "(item (n 3) (tags a \"b\" 4))" );
+
+    Environment::pointer copy = environment.clone( true );
+    CPPUNIT_ASSERT( copy );
+    Values values = copy->evaluate( "(twice 21)" );
+    CPPUNIT_ASSERT( values.size() == 1 && values[0] == 42 );
+    values = copy->evaluate( "?*count*" );
+    CPPUNIT_ASSERT( values.size() == 1 && values[0] == 7 );
+    values = copy->evaluate( "(fact-slot-value (nth$ 1 (find-fact ((?f item)) TRUE)) tags)" );
+    CPPUNIT_ASSERT( values.size() == 3 && values[1] == "b" && values[2] == 4 );
+
+    Environment::pointer empty = environment.clone();
+    CPPUNIT_ASSERT( empty );
+    values = empty->evaluate( "(length$ (find-all-facts ((?f item)) TRUE))" );
+    CPPUNIT_ASSERT( values.size() == 1 && values[0] == 0 );
+  }
+
+  void checkpoint_test() {
+    CPPUNIT_ASSERT( environment.build( "(deftemplate item (slot n) (multislot tags))" ) );
+    CPPUNIT_ASSERT( environment.build( "(defglobal ?*count* = 5)" ) );
+    environment.evaluate( "(bind ?*count* 7)" );
+    environment.assert_fact( "(item (n 3) (tags a \"b\" 4 2.5))" );
+    environment.assert_fact( "(sensor temp -12)" );
+
+    char path[] = "/tmp/clipsmm-checkpoint-XXXXXX";
+    int fd = mkstemp( path );
+    CPPUNIT_ASSERT( fd != -1 );
+    close( fd );
+    CPPUNIT_ASSERT( environment.checkpoint( path ) );
+
+    Environment target;
+    CPPUNIT_ASSERT( target.build( "(deftemplate item (slot extra (default x)) (multislot tags) (slot n))" ) );
+    CPPUNIT_ASSERT( target.build( "(defglobal ?*count* = 0)" ) );
+    CPPUNIT_ASSERT( target.restore( path ) );
+    Values values = target.evaluate( "?*count*" );
+    CPPUNIT_ASSERT( values.size() == 1 && values[0] == 7 );
+    values = target.evaluate( "(fact-slot-value (nth$ 1 (find-fact ((?f item)) TRUE)) tags)" );
+    CPPUNIT_ASSERT( values.size() == 4 && values[1] == "b" && values[2] == 4 && values[3] == 2.5 );
+    values = target.evaluate( "(fact-slot-value (nth$ 1 (find-fact ((?f item)) TRUE)) extra)" );
+    CPPUNIT_ASSERT( values.size() == 1 && values[0] == "x" );
+    values = target.evaluate( "(fact-slot-value (nth$ 1 (find-fact ((?f sensor)) TRUE)) implied)" );
+    CPPUNIT_ASSERT( values.size() == 2 && values[0] == "temp" && values[1] == -12 );
+
+    // Facts of unknown deftemplates are skipped without defining them as ordered
+    Environment bare;
+    CPPUNIT_ASSERT( bare.restore( path ) );
+    CPPUNIT_ASSERT( ! bare.get_template( "item" ) );
+    values = bare.evaluate( "(length$ (find-all-facts ((?f sensor)) TRUE))" );
+    CPPUNIT_ASSERT( values.size() == 1 && values[0] == 1 );
+
+    // A truncated checkpoint changes nothing
+    std::ifstream checkpoint( path, std::ios::in | std::ios::binary );
+    std::string data( ( std::istreambuf_iterator<char>( checkpoint ) ), std::istreambuf_iterator<char>() );
+    checkpoint.close();
+    std::ofstream truncated( path, std::ios::out | std::ios::binary | std::ios::trunc );
+    truncated.write( data.data(), data.size() - 1 );
+    truncated.close();
+    Environment damaged;
+    CPPUNIT_ASSERT( damaged.build( "(defglobal ?*count* = 0)" ) );
+    CPPUNIT_ASSERT( ! damaged.restore( path ) );
+    CPPUNIT_ASSERT( damaged.evaluate( "?*count*" )[0] == 0 );
+    CPPUNIT_ASSERT( damaged.evaluate( "(length$ (find-all-facts ((?f sensor)) TRUE))" )[0] == 0 );
+
+    CPPUNIT_ASSERT( ! target.restore( "strips.clp" ) );
+    unlink( path );
+    CPPUNIT_ASSERT( ! target.restore( path ) );
+  }
+
+  void large_checkpoint_test() {
+    CPPUNIT_ASSERT( environment.build( "(deftemplate entry (slot name) (multislot data))" ) );
+    environment.evaluate( "(loop-for-count (?i 1 5000) "
+                          "(assert (entry (name (str-cat \"value-\" ?i)) (data ?i (str-cat \"tag-\" ?i) (* ?i 1.5)))))" );
+
+    char path[] = "/tmp/clipsmm-checkpoint-XXXXXX";
+    int fd = mkstemp( path );
+    CPPUNIT_ASSERT( fd != -1 );
+    close( fd );
+    CPPUNIT_ASSERT( environment.checkpoint( path ) );
+
+    // Enough distinct values that the periodic cleanup runs while asserting
+    Environment target;
+    CPPUNIT_ASSERT( target.build( "(deftemplate entry (slot name) (multislot data))" ) );
+    CPPUNIT_ASSERT( target.restore( path ) );
+    unlink( path );
+    Values values = target.evaluate( "(length$ (find-all-facts ((?f entry)) TRUE))" );
+    CPPUNIT_ASSERT( values.size() == 1 && values[0] == 5000 );
+    values = target.evaluate( "(fact-slot-value (nth$ 1 (find-fact ((?f entry)) (eq ?f:name \"value-4999\"))) data)" );
+    CPPUNIT_ASSERT( values.size() == 3 && values[0] == 4999 && values[1] == "tag-4999" && values[2] == 7498.5 );
+  }
+
+  void fast_reset_test() {
+    CPPUNIT_ASSERT( environment.build( "(deffacts start (task a) (task b))" ) );
+    CPPUNIT_ASSERT( environment.build( "(defglobal ?*done* = 0)" ) );
+    CPPUNIT_ASSERT( environment.build( "(defrule work (task ?t) => (bind ?*done* (+ ?*done* 1)) (assert (done ?t)))" ) );
+
+    for ( int round = 0; round < 3; ++round ) {
+      environment.fast_reset();
+      Values values = environment.evaluate( "(length$ (find-all-facts ((?f task)) TRUE))" );
+      CPPUNIT_ASSERT( values.size() == 1 && values[0] == 2 );
+      CPPUNIT_ASSERT( environment.evaluate( "?*done*" )[0] == 0 );
+      CPPUNIT_ASSERT( environment.run() == 2 );
+      values = environment.evaluate( "(length$ (find-all-facts ((?f done)) TRUE))" );
+      CPPUNIT_ASSERT( values.size() == 1 && values[0] == 2 );
+      // Changes to the snapshot facts are undone by the next fast_reset()
+      environment.evaluate( "(retract (nth$ 1 (find-fact ((?f task)) (eq ?f:implied (create$ a)))))" );
+    }
+
+    CPPUNIT_ASSERT( environment.build( "(deffacts more (task c))" ) );
+    environment.fast_reset();
+    CPPUNIT_ASSERT( environment.run() == 3 );
+  }
+
+  void reload_changed_test() {
+    char dir[] = "/tmp/clipsmm-reload-XXXXXX";
+    CPPUNIT_ASSERT( mkdtemp( dir ) );
+    std::string templates = std::string( dir ) + "/templates.clp";
+    std::string rules = std::string( dir ) + "/rules.clp";
+    std::ofstream( templates.c_str() ) << "; items\n(deftemplate item (slot n))\n(deftemplate other (slot m))\n";
+    std::ofstream( rules.c_str() ) << "(defrule big (item (n ?n&:(> ?n 10))) => (assert (big ?n)))\n";
+
+    CPPUNIT_ASSERT( environment.load_tracked( templates ) == 1 );
+    CPPUNIT_ASSERT( environment.load_tracked( rules ) == 1 );
+    CPPUNIT_ASSERT( environment.tracked_files().size() == 2 );
+    CPPUNIT_ASSERT( environment.reload_changed() == 0 );
+    environment.assert_fact( "(item (n 5))" );
+    environment.assert_fact( "(other (m 1))" );
+
+    // Only the rule changes, the item fact is matched by the new rule
+    std::ofstream( rules.c_str() ) << "(defrule small (item (n ?n&:(< ?n 10))) => (assert (small ?n)))\n";
+    CPPUNIT_ASSERT( environment.reload_changed() == 1 );
+    CPPUNIT_ASSERT( ! environment.get_rule( "big" ) );
+    CPPUNIT_ASSERT( environment.run() == 1 );
+    Values values = environment.evaluate( "(length$ (find-all-facts ((?f item)) TRUE))" );
+    CPPUNIT_ASSERT( values.size() == 1 && values[0] == 1 );
+
+    // An edit of the same size within the same second is still noticed
+    std::ofstream( rules.c_str() ) << "(defrule small (item (n ?n&:(< ?n 20))) => (assert (small ?n)))\n";
+    CPPUNIT_ASSERT( environment.reload_changed() == 1 );
+    CPPUNIT_ASSERT( environment.reload_changed() == 0 );
+
+    // item is used by the rules file, both files are reloaded; other keeps its fact
+    std::ofstream( templates.c_str() ) << "(deftemplate item (slot n) (slot label))\n(deftemplate other (slot m))\n";
+    CPPUNIT_ASSERT( environment.reload_changed() == 2 );
+    values = environment.evaluate( "(length$ (find-all-facts ((?f item)) TRUE))" );
+    CPPUNIT_ASSERT( values.size() == 1 && values[0] == 0 );
+    values = environment.evaluate( "(length$ (find-all-facts ((?f other)) TRUE))" );
+    CPPUNIT_ASSERT( values.size() == 1 && values[0] == 1 );
+    CPPUNIT_ASSERT( environment.get_rule( "small" ) );
+
+    unlink( templates.c_str() );
+    unlink( rules.c_str() );
+    rmdir( dir );
+    CPPUNIT_ASSERT( environment.reload_changed() == -1 );
+  }
+
+  void environment_manager_test() {
+    char dir[] = "/tmp/clipsmm-manager-XXXXXX";
+    CPPUNIT_ASSERT( mkdtemp( dir ) );
+    Environment::pointer prototype( new Environment() );
+    CPPUNIT_ASSERT( prototype->build( "(deftemplate visit (slot n))" ) );
+    {
+      EnvironmentManager manager( prototype, dir, 2 );
+      manager.get( "a" )->assert_fact( "(visit (n 1))" );
+      manager.get( "b" )->assert_fact( "(visit (n 2))" );
+      manager.get( "c" )->assert_fact( "(visit (n 3))" );
+      EnvironmentManager::Stats stats = manager.stats();
+      CPPUNIT_ASSERT( stats.created == 3 && stats.evictions == 1 && stats.resident == 2 );
+
+      // a was least recently used, it comes back from its checkpoint
+      Values values = manager.get( "a" )->evaluate( "(fact-slot-value (nth$ 1 (find-fact ((?f visit)) TRUE)) n)" );
+      CPPUNIT_ASSERT( values.size() == 1 && values[0] == 1 );
+      manager.get( "a" );
+      stats = manager.stats();
+      CPPUNIT_ASSERT( stats.misses == 1 && stats.hits == 1 && stats.evictions == 2 );
+      CPPUNIT_ASSERT( stats.hit_rate() == 0.5 );
+
+      // Referenced environments stay resident
+      Environment::pointer held = manager.get( "a" );
+      CPPUNIT_ASSERT( ! manager.evict( "a" ) );
+      held.reset();
+      CPPUNIT_ASSERT( manager.evict( "a" ) );
+
+      // A damaged checkpoint is kept and reported until the tenant is removed
+      std::ostringstream checkpoint;
+      checkpoint << dir << "/tenant-" << getpid() << "-0.ckpt";
+      std::ofstream( checkpoint.str().c_str(), std::ios::trunc ) << "damaged";
+      CPPUNIT_ASSERT( ! manager.get( "a" ) );
+      CPPUNIT_ASSERT( ! manager.get( "a" ) );
+      CPPUNIT_ASSERT( manager.stats().restore_failures == 2 );
+      manager.remove( "a" );
+      CPPUNIT_ASSERT( access( checkpoint.str().c_str(), F_OK ) != 0 );
+    }
+    CPPUNIT_ASSERT( rmdir( dir ) == 0 );
+  }
+
+  void eviction_refraction_test() {
+    char dir[] = "/tmp/clipsmm-manager-XXXXXX";
+    CPPUNIT_ASSERT( mkdtemp( dir ) );
+    Environment::pointer prototype( new Environment() );
+    CPPUNIT_ASSERT( prototype->build( "(defglobal ?*greetings* = 0)" ) );
+    CPPUNIT_ASSERT( prototype->build( "(defrule greet (visitor ?v) => (bind ?*greetings* (+ ?*greetings* 1)))" ) );
+    {
+      EnvironmentManager manager( prototype, dir, 0 );
+      Environment::pointer tenant = manager.get( "a" );
+      tenant->assert_fact( "(visitor x)" );
+      CPPUNIT_ASSERT( tenant->run() == 1 );
+      CPPUNIT_ASSERT( tenant->run() == 0 );
+      tenant.reset();
+      CPPUNIT_ASSERT( manager.evict( "a" ) );
+
+      // Refraction is lost, the rule fires again for the restored fact
+      tenant = manager.get( "a" );
+      CPPUNIT_ASSERT( tenant->run() == 1 );
+      CPPUNIT_ASSERT( tenant->evaluate( "?*greetings*" )[0] == 2 );
+    }
+    CPPUNIT_ASSERT( rmdir( dir ) == 0 );
+  }
+
+  void construct_names_test() {
+    CPPUNIT_ASSERT( environment.build( "(defrule first (a) => )" ) );
+    std::vector<std::string> rules = environment.get_construct_names( CONSTRUCT_RULE );
+    CPPUNIT_ASSERT( rules.size() == 1 && rules[0] == "first" );
+    CPPUNIT_ASSERT( environment.get_construct_names( CONSTRUCT_RULE ) == rules );
+
+    CPPUNIT_ASSERT( environment.build( "(defrule second (b) => )" ) );
+    CPPUNIT_ASSERT( environment.get_rule_names().size() == 2 );
+    CPPUNIT_ASSERT( environment.get_rule( "first" )->retract() );
+    CPPUNIT_ASSERT( environment.get_rule_names().size() == 1 );
+    CPPUNIT_ASSERT( environment.get_construct_names( CONSTRUCT_RULE, environment.get_module( "MAIN" ) ).size() == 1 );
+
+    visited_constructs.clear();
+    environment.visit_constructs( CONSTRUCT_RULE, sigc::ptr_fun( &visit_construct ) );
+    CPPUNIT_ASSERT( visited_constructs.size() == 1 && visited_constructs[0] == "MAIN::second" );
+
+    // Listings are checked, not dropped, after CLIPS code ran
+    environment.evaluate( "(+ 1 2)" );
+    CPPUNIT_ASSERT( environment.get_rule_names().size() == 1 );
+    environment.evaluate( "(build \"(defrule third (c) => )\")" );
+    std::vector<std::string> names = environment.get_construct_names( CONSTRUCT_RULE );
+    CPPUNIT_ASSERT( names.size() == 2 );
+    for ( unsigned int i = 0; i < names.size(); ++i )
+      environment.evaluate( "(undefrule " + names[i] + ")" );
+    CPPUNIT_ASSERT( environment.get_rule_names().empty() );
+  }
+
+  void construct_handles_test() {
+    CPPUNIT_ASSERT( environment.build( "(deftemplate point (slot x))" ) );
+    CPPUNIT_ASSERT( environment.build( "(defrule seen (point) => )" ) );
+    Template::pointer point = environment.get_template( "point" );
+    CPPUNIT_ASSERT( point && environment.get_template( "point" ) == point );
+    Rule::pointer seen = environment.get_rule( "seen" );
+    CPPUNIT_ASSERT( seen && environment.get_rule( "seen" ) == seen );
+    CPPUNIT_ASSERT( ! environment.get_rule( "unseen" ) );
+
+    // Running CLIPS code keeps the wrappers of constructs it did not touch
+    environment.evaluate( "(+ 1 2)" );
+    environment.run();
+    CPPUNIT_ASSERT( environment.get_rule( "seen" ) == seen );
+    CPPUNIT_ASSERT( environment.get_template( "point" ) == point );
+
+    CPPUNIT_ASSERT( seen->retract() );
+    CPPUNIT_ASSERT( ! environment.get_rule( "seen" ) );
+
+    // Constructs undefined by CLIPS code are noticed as well
+    CPPUNIT_ASSERT( environment.build( "(defrule first (point) => )" ) );
+    CPPUNIT_ASSERT( environment.build( "(defrule second (point) => )" ) );
+    CPPUNIT_ASSERT( environment.build( "(defrule drop (drop) => (undefrule second))" ) );
+    CPPUNIT_ASSERT( environment.get_rule( "first" ) && environment.get_rule( "second" ) );
+    environment.evaluate( "(undefrule first)" );
+    CPPUNIT_ASSERT( ! environment.get_rule( "first" ) );
+    environment.assert_fact( "(drop)" );
+    CPPUNIT_ASSERT( environment.run() == 1 );
+    CPPUNIT_ASSERT( ! environment.get_rule( "second" ) );
+    environment.remove_rules();
+    CPPUNIT_ASSERT( ! environment.get_rule( "drop" ) );
+
+    environment.clear();
+    CPPUNIT_ASSERT( ! environment.get_template( "point" ) );
+    CPPUNIT_ASSERT( environment.build( "(deftemplate point (slot x) (slot y))" ) );
+    Template::pointer redefined = environment.get_template( "point" );
+    CPPUNIT_ASSERT( redefined && redefined != point );
+  }
+
+  void agenda_snapshot_test() {
+    CPPUNIT_ASSERT( environment.build( "(defrule low (declare (salience -5)) (job ?j) => )" ) );
+    CPPUNIT_ASSERT( environment.build( "(defrule high (declare (salience 10)) (job ?j) => )" ) );
+    environment.assert_fact( "(job 1)" );
+    environment.assert_fact( "(job 2)" );
+
+    std::vector<ActivationInfo> agenda = environment.agenda_snapshot( environment.get_module( "MAIN" ) );
+    CPPUNIT_ASSERT( agenda.size() == 4 );
+    CPPUNIT_ASSERT( std::string( agenda[0].rule ) == "high" && agenda[0].salience == 10 );
+    CPPUNIT_ASSERT( std::string( agenda[3].rule ) == "low" && agenda[3].salience == -5 );
+    CPPUNIT_ASSERT( std::string( agenda[0].module ) == "MAIN" );
+    CPPUNIT_ASSERT( agenda[0].timetag > agenda[1].timetag );
+
+    environment.run( 1 );
+    environment.agenda_snapshot( agenda );
+    CPPUNIT_ASSERT( agenda.size() == 3 );
+  }
+
+  void preemption_test() {
+    CPPUNIT_ASSERT( environment.build( "(defrule count ?f <- (counter ?n&:(< ?n 500000)) => "
+                                       "(retract ?f) (assert (counter (+ ?n 1))))" ) );
+    environment.assert_fact( "(counter 0)" );
+
+    CPPUNIT_ASSERT( environment.run_threaded( -1, 0 ) );
+    usleep( 20000 );
+    CPPUNIT_ASSERT( environment.run_threaded( 10, 5 ) );
+    environment.join_run_thread();
+
+    std::map<int, Environment::RunStatistics> stats = environment.run_statistics();
+    CPPUNIT_ASSERT( stats[0].preemptions == 1 && stats[0].jobs == 1 );
+    CPPUNIT_ASSERT( stats[5].preemptions == 0 && stats[5].jobs == 1 );
+  }
+
+  void coalescing_test() {
+    CPPUNIT_ASSERT( environment.build( "(defrule count ?f <- (counter ?n&:(< ?n 500000)) => "
+                                       "(retract ?f) (assert (counter (+ ?n 1))))" ) );
+    environment.assert_fact( "(counter 0)" );
+
+    // Both low priority requests are queued while the first job runs
+    CPPUNIT_ASSERT( environment.run_threaded( -1, 0 ) );
+    usleep( 20000 );
+    CPPUNIT_ASSERT( environment.run_threaded( 10, -1 ) );
+    CPPUNIT_ASSERT( environment.run_threaded( 10, -1 ) );
+    environment.join_run_thread();
+
+    std::map<int, Environment::RunStatistics> stats = environment.run_statistics();
+    CPPUNIT_ASSERT( stats[0].jobs == 1 && stats[0].coalesced == 0 );
+    CPPUNIT_ASSERT( stats[-1].jobs == 1 && stats[-1].coalesced == 1 );
+    // Each merged request accounts its own wait
+    CPPUNIT_ASSERT( stats[-1].total_wait > stats[-1].max_wait );
+  }
+
+  void completion_notification_test() {
+    CPPUNIT_ASSERT( environment.build( "(defrule done (job ?j) => )" ) );
+    environment.assert_fact( "(job 1)" );
+    environment.assert_fact( "(job 2)" );
+
+    struct pollfd pfd;
+    pfd.fd = environment.notification_fd();
+    pfd.events = POLLIN;
+    CPPUNIT_ASSERT( pfd.fd != -1 );
+    CPPUNIT_ASSERT( poll( &pfd, 1, 0 ) == 0 );
+
+    CPPUNIT_ASSERT( environment.run_threaded( -1, 3 ) );
+    environment.join_run_thread();
+    CPPUNIT_ASSERT( poll( &pfd, 1, 0 ) == 1 && ( pfd.revents & POLLIN ) );
+
+    std::vector<Environment::RunCompletion> completions = environment.poll_completions();
+    CPPUNIT_ASSERT( completions.size() == 1 );
+    CPPUNIT_ASSERT( completions[0].priority == 3 && completions[0].executed == 2 );
+    CPPUNIT_ASSERT( poll( &pfd, 1, 0 ) == 0 );
+    CPPUNIT_ASSERT( environment.poll_completions().empty() );
+  }
+};
+
+#endif
@@ -0,0 +1,118 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by the clipsmm developers                          *
+ *                                                                         *
+ *   This file is part of the clipsmm library.                             *
+ *                                                                         *
+ *   The clipsmm library is free software; you can redistribute it and/or  *
+ *   modify it under the terms of the GNU General Public License           *
+ *   version 3 as published by the Free Software Foundation.               *
+ *                                                                         *
+ *   The clipsmm library is distributed in the hope that it will be        *
+ *   useful, but WITHOUT ANY WARRANTY; without even the implied warranty   *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU   *
+ *   General Public License for more details.                              *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this software. If not see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+#ifndef ENVIRONMENTGROUPTEST_H
+#define ENVIRONMENTGROUPTEST_H
+
+#include <cppunit/TestFixture.h>
+
+#include <clipsmm.h>
+
+#include <sstream>
+#include <stdexcept>
+
+using namespace CLIPS;
+
+/** Routes (order <customer> ...) facts by customer */
+std::string order_customer( const std::string& fact ) {
+  std::string::size_type start = fact.find( ' ' ) + 1;
+  return fact.substr( start, fact.find_first_of( " )", start ) - start );
+}
+
+class EnvironmentGroupTest : public  CppUnit::TestFixture {
+  public:
+
+  CPPUNIT_TEST_SUITE( EnvironmentGroupTest );
+  CPPUNIT_TEST( shard_index_test );
+  CPPUNIT_TEST( key_routing_test );
+  CPPUNIT_TEST( gathered_results_test );
+  CPPUNIT_TEST_SUITE_END();
+
+  protected:
+    EnvironmentGroup::pointer group;
+
+  public:
+    void setUp() {
+      group = EnvironmentGroup::create( 4 );
+      CPPUNIT_ASSERT( group->build( "(defglobal ?*fired* = 0)" ) );
+      CPPUNIT_ASSERT( group->build( "(defrule count (order ?c ?n) => (bind ?*fired* (+ ?*fired* 1)))" ) );
+    }
+
+    void tearDown() {
+      group.reset();
+    }
+
+  void shard_index_test() {
+    CPPUNIT_ASSERT( group->size() == 4 );
+    for ( int i = 0; i < 100; ++i ) {
+      std::ostringstream key;
+      key << "customer-" << i;
+      unsigned int index = group->shard_index( key.str() );
+      CPPUNIT_ASSERT( index < group->size() );
+      CPPUNIT_ASSERT( group->shard_index( key.str() ) == index );
+    }
+    CPPUNIT_ASSERT_THROW( group->shard( 4 ), std::out_of_range );
+    CPPUNIT_ASSERT_THROW( EnvironmentGroup::create( 0 ), std::logic_error );
+  }
+
+  void key_routing_test() {
+    CPPUNIT_ASSERT_THROW( group->assert_fact( "(order alice 1)" ), std::logic_error );
+    group->set_key_function( sigc::ptr_fun( &order_customer ) );
+
+    const char* customers[] = { "alice", "bob", "carol", "dave", "erin" };
+    for ( int i = 0; i < 5; ++i ) {
+      std::ostringstream fact;
+      fact << "(order " << customers[i] << " " << i << ")";
+      CPPUNIT_ASSERT( group->assert_fact( fact.str() ) );
+    }
+    CPPUNIT_ASSERT( group->assert_fact( "alice", "(order alice 5)" ) );
+
+    for ( int i = 0; i < 5; ++i ) {
+      std::string query = std::string( "(length$ (find-all-facts ((?f order)) (eq (nth$ 1 ?f:implied) " ) + customers[i] + ")))";
+      unsigned int expected = group->shard_index( customers[i] );
+      for ( unsigned int s = 0; s < group->size(); ++s ) {
+        Values values = group->shard( s ).evaluate( query );
+        CPPUNIT_ASSERT( values.size() == 1 );
+        CPPUNIT_ASSERT( values[0] == ( s != expected ? 0 : ( i == 0 ? 2 : 1 ) ) );
+      }
+    }
+  }
+
+  void gathered_results_test() {
+    for ( int i = 0; i < 20; ++i ) {
+      std::ostringstream key, fact;
+      key << "customer-" << i;
+      fact << "(order " << key.str() << " " << i << ")";
+      group->assert_fact( key.str(), fact.str() );
+    }
+
+    CPPUNIT_ASSERT( group->run() == 20 );
+    std::vector<Values> fired = group->global_values( "fired" );
+    std::vector<Values> counts = group->evaluate( "(length$ (find-all-facts ((?f order)) TRUE))" );
+    CPPUNIT_ASSERT( fired.size() == 4 && counts.size() == 4 );
+    long int total = 0;
+    for ( unsigned int s = 0; s < 4; ++s ) {
+      CPPUNIT_ASSERT( fired[s].size() == 1 && counts[s].size() == 1 );
+      CPPUNIT_ASSERT( fired[s][0].as_integer() == counts[s][0].as_integer() );
+      total += fired[s][0].as_integer();
+    }
+    CPPUNIT_ASSERT( total == 20 );
+    CPPUNIT_ASSERT( group->global_values( "no-such-global" )[0].empty() );
+  }
+};
+
+#endif
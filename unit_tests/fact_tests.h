@@ -39,6 +39,8 @@ class FactsTest : public  CppUnit::TestFixture {
     CPPUNIT_TEST( set_template_new_fact_slot_values );
     CPPUNIT_TEST( template_fact_retraction );
     CPPUNIT_TEST( ordered_fact_retraction );
+    CPPUNIT_TEST( assert_pattern_template_fact );
+    CPPUNIT_TEST( assert_pattern_ordered_fact );
     CPPUNIT_TEST_SUITE_END();
 
   protected:
@@ -137,6 +139,43 @@ class FactsTest : public  CppUnit::TestFixture {
       CPPUNIT_ASSERT( ! ordered_fact->exists() );
     }
 
+    void assert_pattern_template_fact() {
+      AssertPattern::pointer pattern = environment.prepare_assert( "(in (object ?) (location ?))" );
+      CPPUNIT_ASSERT( pattern );
+      CPPUNIT_ASSERT( pattern->placeholders() == 2 );
+      Fact::pointer fact = pattern->assert_fact( Value( "C3PO", TYPE_SYMBOL ), "Millenium Falcon" );
+      CPPUNIT_ASSERT( fact );
+      Values values = fact->slot_value( "object" );
+      CPPUNIT_ASSERT( values.size() == 1 );
+      CPPUNIT_ASSERT( values[0] == "C3PO" );
+      CPPUNIT_ASSERT( values[0].type() == TYPE_SYMBOL );
+      values = fact->slot_value( "location" );
+      CPPUNIT_ASSERT( values.size() == 1 );
+      CPPUNIT_ASSERT( values[0].type() == TYPE_STRING );
+      CPPUNIT_ASSERT( ! pattern->assert_fact( Value( "C3PO", TYPE_SYMBOL ) ) );
+      CPPUNIT_ASSERT( ! environment.prepare_assert( "(in (speed ?))" ) );
+      environment.clear();
+      CPPUNIT_ASSERT( ! pattern->is_valid() );
+      CPPUNIT_ASSERT( ! pattern->assert_fact( 1, 2 ) );
+    }
+
+    void assert_pattern_ordered_fact() {
+      AssertPattern::pointer pattern = environment.prepare_assert( "(numbers 1 ? 3 ?)" );
+      CPPUNIT_ASSERT( pattern );
+      Fact::pointer fact = pattern->assert_fact( 2, 4.5 );
+      CPPUNIT_ASSERT( fact );
+      Values values = fact->slot_value( "" );
+      CPPUNIT_ASSERT( values.size() == 4 );
+      CPPUNIT_ASSERT( values[0] == 1 );
+      CPPUNIT_ASSERT( values[1] == 2 );
+      CPPUNIT_ASSERT( values[2] == 3 );
+      CPPUNIT_ASSERT( values[3] == 4.5 );
+
+      // A malformed pattern must not leave an implied template behind
+      CPPUNIT_ASSERT( ! environment.prepare_assert( "(unknown 1 (x 2))" ) );
+      CPPUNIT_ASSERT( ! environment.get_template( "unknown" ) );
+    }
+
 };
 
 #endif
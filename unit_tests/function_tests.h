@@ -26,6 +26,7 @@
 
 #include <sstream>
 #include <cstdlib>
+#include <cstring>
 
 using namespace CLIPS;
 
@@ -65,6 +66,10 @@ float function7(int i1, long l1, double d1, float f, int i2, long l2, double d2)
   return i1+l1+d1+f+i2+l2+d2;
 }
 
+long fact_index_of(FactRef fact) { return fact.index(); }
+
+Fact::pointer same_fact(Fact::pointer fact) { return fact; }
+
 
 class FunctionTest : public  CppUnit::TestFixture {
   public:
@@ -106,6 +111,18 @@ class FunctionTest : public  CppUnit::TestFixture {
   CPPUNIT_TEST( function_test_5 );
   CPPUNIT_TEST( function_test_6 );
   CPPUNIT_TEST( function_test_7 );
+  CPPUNIT_TEST( function_pointer_test );
+  CPPUNIT_TEST( lambda_test );
+  CPPUNIT_TEST( lambda_test_10 );
+  CPPUNIT_TEST( lexeme_argument_test );
+  CPPUNIT_TEST( multifield_view_test );
+  CPPUNIT_TEST( double_span_test );
+  CPPUNIT_TEST( function_profiling_test );
+  CPPUNIT_TEST( prepared_expression_test );
+  CPPUNIT_TEST( prepared_expression_clear_test );
+  CPPUNIT_TEST( call_test );
+  CPPUNIT_TEST( evaluate_batch_test );
+  CPPUNIT_TEST( fact_address_test );
   CPPUNIT_TEST_SUITE_END();
 
   protected:
@@ -481,7 +498,192 @@ class FunctionTest : public  CppUnit::TestFixture {
     CPPUNIT_ASSERT( values[0] == (float)(3+56l+3.8+1.3f+42+192l+28.444) );
   }
 
+  void function_pointer_test() {
+    environment.add_function( "function2p", &function2 );
+    Values values = environment.function( "function2p", "42 38.8" );
+    CPPUNIT_ASSERT( values.size() == 1 );
+    CPPUNIT_ASSERT( values[0] == 42+38.8 );
+  }
+
+  void lambda_test() {
+    environment.add_function( "lambda1", [this]( const std::string& s ) {
+        temp_class_int = s.size();
+        return s + s;
+      } );
+    Values values = environment.function( "lambda1", "abc" );
+    CPPUNIT_ASSERT( values.size() == 1 );
+    CPPUNIT_ASSERT( values[0] == "abcabc" );
+    CPPUNIT_ASSERT( temp_class_int == 3 );
+  }
+
+  void lambda_test_10() {
+    environment.add_function( "lambda10", []( int a, int b, int c, int d, int e,
+                                             int f, int g, int h, int i, long j ) {
+        return a+b+c+d+e+f+g+h+i+j;
+      } );
+    Values values = environment.function( "lambda10", "1 2 3 4 5 6 7 8 9 10" );
+    CPPUNIT_ASSERT( values.size() == 1 );
+    CPPUNIT_ASSERT( values[0] == 55l );
+  }
+
+  void lexeme_argument_test() {
+    environment.add_function( "lexeme_length", []( const char* s ) { return (long)strlen(s); } );
+    Values values = environment.function( "lexeme_length", "\"hello\"" );
+    CPPUNIT_ASSERT( values.size() == 1 );
+    CPPUNIT_ASSERT( values[0] == 5l );
+    values = environment.function( "lexeme_length", "abc" );
+    CPPUNIT_ASSERT( values.size() == 1 );
+    CPPUNIT_ASSERT( values[0] == 3l );
+  }
+
+  void multifield_view_test() {
+    environment.add_function( "mf_describe", []( const MultifieldView& v ) {
+        std::ostringstream sout;
+        for ( std::size_t i = 0; i < v.size(); ++i ) {
+          if ( v.type(i) == TYPE_SYMBOL ) sout << v.as_string(i);
+          else sout << v.as_integer(i);
+        }
+        return sout.str();
+      } );
+    Values values = environment.evaluate( "(mf_describe (create$ a 1 b 2.5))" );
+    CPPUNIT_ASSERT( values.size() == 1 );
+    CPPUNIT_ASSERT( values[0] == "a1b2" );
+  }
+
+  void double_span_test() {
+    environment.add_function( "span_dot", []( DoubleSpan a, DoubleSpan b ) {
+        double sum = 0.0;
+        for ( std::size_t i = 0; i < a.size() && i < b.size(); ++i ) sum += a[i] * b[i];
+        return sum;
+      } );
+    Values values = environment.evaluate( "(span_dot (create$ 1 2 3) (create$ 4.0 5.0 6.0))" );
+    CPPUNIT_ASSERT( values.size() == 1 );
+    CPPUNIT_ASSERT( values[0] == 32.0 );
+  }
+
+  void function_profiling_test() {
+    environment.add_function( "profiled", []( long l ) { return l + 1; } );
+    environment.function( "profiled", "1" );
+    CPPUNIT_ASSERT( environment.function_stats()["profiled"].calls == 0 );
+
+    environment.enable_function_profiling();
+    environment.evaluate( "(loop-for-count 10 (profiled 1))" );
+    environment.enable_function_profiling( false );
+
+    FunctionStats stats = environment.function_stats()["profiled"];
+    CPPUNIT_ASSERT( stats.calls == 10 );
+    unsigned long int bucketed = 0;
+    for ( unsigned int i = 0; i < FunctionStats::NUM_BUCKETS; ++i ) bucketed += stats.histogram[i];
+    CPPUNIT_ASSERT( bucketed == 10 );
+    CPPUNIT_ASSERT( stats.max_time <= stats.total_time );
 
+    environment.reset_function_stats();
+    CPPUNIT_ASSERT( environment.function_stats()["profiled"].calls == 0 );
+  }
+
+  void prepared_expression_test() {
+    Expression::pointer expression = environment.prepare( "(+ ?a (* ?b 2))" );
+    CPPUNIT_ASSERT( expression );
+    CPPUNIT_ASSERT( expression->parameters().size() == 2 );
+    CPPUNIT_ASSERT( expression->evaluate().empty() );
+
+    CPPUNIT_ASSERT( expression->bind( "a", 1l ) );
+    CPPUNIT_ASSERT( expression->bind( "?b", 20l ) );
+    CPPUNIT_ASSERT( ! expression->bind( "c", 1l ) );
+    Values values = expression->evaluate();
+    CPPUNIT_ASSERT( values.size() == 1 );
+    CPPUNIT_ASSERT( values[0] == 41l );
+
+    CPPUNIT_ASSERT( expression->bind( "a", 2l ) );
+    values = expression->evaluate();
+    CPPUNIT_ASSERT( values.size() == 1 );
+    CPPUNIT_ASSERT( values[0] == 42l );
+
+    CPPUNIT_ASSERT( ! environment.prepare( "(+ 1" ) );
+  }
+
+  void prepared_expression_clear_test() {
+    Expression::pointer expression = environment.prepare( "(+ 1 2)" );
+    CPPUNIT_ASSERT( expression->is_valid() );
+    environment.clear();
+    CPPUNIT_ASSERT( ! expression->is_valid() );
+    CPPUNIT_ASSERT( expression->evaluate().empty() );
+  }
+
+  void call_test() {
+    Values args;
+    args.push_back( Value( 3l ) );
+    args.push_back( Value( 4l ) );
+    Values values = environment.call( "+", args );
+    CPPUNIT_ASSERT( values.size() == 1 );
+    CPPUNIT_ASSERT( values[0] == (3+4) );
+
+    environment.add_function( "call_concat", &function3 );
+    values = environment.call( "call_concat", std::string( "hello" ), std::string( "world" ) );
+    CPPUNIT_ASSERT( values.size() == 1 );
+    CPPUNIT_ASSERT( values[0] == "helloworld" );
+
+    CPPUNIT_ASSERT( environment.call( "no-such-function" ).empty() );
+  }
+
+
+  void evaluate_batch_test() {
+    std::vector<std::string> expressions;
+    expressions.push_back( "(+ 1 2)" );
+    expressions.push_back( "(+ 1" );
+    expressions.push_back( "(create$ a b)" );
+
+    std::vector<Environment::EvaluationResult> results;
+    CPPUNIT_ASSERT( environment.evaluate_batch( expressions, results ) == 2 );
+    CPPUNIT_ASSERT( results.size() == 3 );
+    CPPUNIT_ASSERT( results[0].ok && results[0].values[0] == 3 );
+    CPPUNIT_ASSERT( ! results[1].ok && results[1].values.empty() );
+    CPPUNIT_ASSERT( results[2].ok && results[2].values.size() == 2 );
+
+    std::vector<Expression::pointer> prepared;
+    prepared.push_back( environment.prepare( "(* ?x 2)" ) );
+    prepared.push_back( environment.prepare( "(* ?y 2)" ) );
+    prepared[0]->bind( "x", Value( 21l ) );
+    CPPUNIT_ASSERT( environment.evaluate_batch( prepared, results ) == 1 );
+    CPPUNIT_ASSERT( results.size() == 2 );
+    CPPUNIT_ASSERT( results[0].ok && results[0].values[0] == 42 );
+    CPPUNIT_ASSERT( ! results[1].ok );
+
+    // A runtime error does not halt the expressions after it
+    CPPUNIT_ASSERT( environment.build( "(deffunction twice (?x) (bind ?y (* ?x 2)) ?y)" ) );
+    expressions.clear();
+    expressions.push_back( "(twice 2)" );
+    expressions.push_back( "(div 1 0)" );
+    expressions.push_back( "(twice 5)" );
+    CPPUNIT_ASSERT( environment.evaluate_batch( expressions, results ) == 2 );
+    CPPUNIT_ASSERT( results[0].ok && results[0].values[0] == 4 );
+    CPPUNIT_ASSERT( ! results[1].ok );
+    CPPUNIT_ASSERT( results[2].ok && results[2].values[0] == 10 );
+
+    prepared.clear();
+    prepared.push_back( environment.prepare( "(div 1 0)" ) );
+    prepared.push_back( environment.prepare( "(twice 21)" ) );
+    CPPUNIT_ASSERT( environment.evaluate_batch( prepared, results ) == 1 );
+    CPPUNIT_ASSERT( ! results[0].ok );
+    CPPUNIT_ASSERT( results[1].ok && results[1].values[0] == 42 );
+  }
+
+  void fact_address_test() {
+    environment.add_function( "fact-index-of", &fact_index_of );
+    environment.add_function( "same-fact", &same_fact );
+    Fact::pointer fact = environment.assert_fact( "(marker 1)" );
+    CPPUNIT_ASSERT( fact );
+
+    Values values = environment.evaluate( "(fact-index-of (nth$ 1 (find-fact ((?f marker)) TRUE)))" );
+    CPPUNIT_ASSERT( values.size() == 1 );
+    CPPUNIT_ASSERT( values[0] == fact->index() );
+
+    values = environment.call( "same-fact", Value( fact->cobj(), TYPE_FACT_ADDRESS ) );
+    CPPUNIT_ASSERT( values.size() == 1 );
+    CPPUNIT_ASSERT( values[0].type() == TYPE_FACT_ADDRESS );
+    CPPUNIT_ASSERT( values[0].as_address() == fact->cobj() );
+    CPPUNIT_ASSERT( environment.evaluate( "(fact-index-of 1)" ).empty() );
+  }
 };
 
 #endif